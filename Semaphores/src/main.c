@@ -3,7 +3,6 @@
 #include <devicetree.h>
 #include <drivers/gpio.h>
 #include <drivers/pwm.h>
-#include <drivers/adc.h>
 #include <sys/printk.h>
 #include <sys/__assert.h>
 #include <timing/timing.h>
@@ -11,81 +10,37 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "thread_stats.h"
+#include "trace_markers.h"
+#include "latency_hist.h"
+#include "pipeline_cfg.h"
+#include "filter.h"
+#include "replay.h"
+#include "handoff.h"
+#include "stress.h"
+#include "sched_profile.h"
+#include "spectrum.h"
+#include "chan.h"
+#include "fanin.h"
+#include "pipeline_steps.h"
+
 #define GPIO0_NID DT_NODELABEL(gpio0) 
 #define PWM0_NID DT_NODELABEL(pwm0) 
-#define BOARDLED_PIN 0x0e
-
-/*ADC definitions and includes*/
-#include <hal/nrf_saadc.h>
-#define ADC_NID DT_NODELABEL(adc) 
-#define ADC_RESOLUTION 10
-#define ADC_GAIN ADC_GAIN_1_4
-#define ADC_REFERENCE ADC_REF_VDD_1_4
-#define ADC_ACQUISITION_TIME ADC_ACQ_TIME(ADC_ACQ_TIME_MICROSECONDS, 40)
-#define ADC_CHANNEL_ID 1  
-
-/* This is the actual nRF ANx input to use. Note that a channel can be assigned to any ANx. In fact a channel can */
-/*    be assigned to two ANx, when differential reading is set (one ANx for the positive signal and the other one for the negative signal) */  
-/* Note also that the configuration of differnt channels is completely independent (gain, resolution, ref voltage, ...) */
-#define ADC_CHANNEL_INPUT NRF_SAADC_INPUT_AIN1 
-
-#define BUFFER_SIZE 1
-
-/* ADC channel configuration */
-static const struct adc_channel_cfg my_channel_cfg = {
-	.gain = ADC_GAIN,
-	.reference = ADC_REFERENCE,
-	.acquisition_time = ADC_ACQUISITION_TIME,
-	.channel_id = ADC_CHANNEL_ID,
-	.input_positive = ADC_CHANNEL_INPUT
-};
 
 /* Global vars */
 struct k_timer my_timer;
-const struct device *adc_dev = NULL;
-static uint16_t adc_sample_buffer[BUFFER_SIZE];
-
-int array[10];
-int array_final_10[10];
-int ctrl_10=0;
 
-/* Takes one sample */
-static int adc_sample(void)
-{
-	int ret;
-	const struct adc_sequence sequence = {
-		.channels = BIT(ADC_CHANNEL_ID),
-		.buffer = adc_sample_buffer,
-		.buffer_size = sizeof(adc_sample_buffer),
-		.resolution = ADC_RESOLUTION,
-	};
-
-	if (adc_dev == NULL) {
-            printk("adc_sample(): error, must bind to adc first \n\r");
-            return -1;
-	}
-
-	ret = adc_read(adc_dev, &sequence);
-	if (ret) {
-            printk("adc_read() failed with code %d\n", ret);
-	}	
-
-	return ret;
-}
 
 //#######################################################
 
 /* Size of stack area used by each thread (can be thread specific, if necessary)*/
 #define STACK_SIZE 1024
 
-/* Thread scheduling priority */
+/* Thread scheduling priority (at creation; the profile in sched_profile.h sets the final ones) */
 #define thread_ADC_prio 1
 #define thread_FILTRO_prio 1
 #define thread_PWM_prio 1
 
-/* Therad periodicity (in ms)*/
-#define thread_ADC_period 1000
-
 
 /* Create thread stack space */
 K_THREAD_STACK_DEFINE(thread_ADC_stack, STACK_SIZE);
@@ -102,13 +57,15 @@ k_tid_t thread_ADC_tid;
 k_tid_t thread_FILTRO_tid;
 k_tid_t thread_PWM_tid;
 
-/* Global vars (shared memory between tasks A/B and B/C, resp) */
-int val_1 = 0;
-int media_final = 0;
+/* Semaphores for task synch: bounded rings of values, with the overload policy of handoff.h */
+HANDOFF_SEM_DEFINE(sem_val_1);
+HANDOFF_SEM_DEFINE(sem_media_final);
 
-/* Semaphores for task synch */
-struct k_sem sem_val_1;
-struct k_sem sem_media_final;
+/* Hand-off to FILTRO of samples taken outside the periodic loop */
+static int put_val_1(const struct handoff_msg *msg)
+{
+    return handoff_sem_put(&sem_val_1, msg);
+}
 
 /* Thread code prototypes */
 void thread_ADC_code(void *argA, void *argB, void *argC);
@@ -119,10 +76,20 @@ void thread_PWM_code(void *argA, void *argB, void *argC);
 
 void main(void)
 {
+    /* Restore the saved configuration before the pipeline starts */
+    pipeline_cfg_init();
+
      /* Create and init semaphores */
-    k_sem_init(&sem_val_1, 0, 1);
-    k_sem_init(&sem_media_final, 0, 1);
+    handoff_sem_init(&sem_val_1, "val_1");
+    handoff_sem_init(&sem_media_final, "media_final");
+    pipeline_steps_init(put_val_1);
     
+#ifdef CONFIG_APP_CYCLIC
+    /* One time-triggered thread runs all stages, see cyclic.h */
+    pipeline_cyclic_start();
+    return;
+#endif
+
     /* Create tasks */
     thread_ADC_tid = k_thread_create(&thread_ADC_data, thread_ADC_stack,
         K_THREAD_STACK_SIZEOF(thread_ADC_stack), thread_ADC_code,
@@ -132,21 +99,48 @@ void main(void)
         K_THREAD_STACK_SIZEOF(thread_FILTRO_stack), thread_FILTRO_code,
         NULL, NULL, NULL, thread_FILTRO_prio, 0, K_NO_WAIT);
 
-    thread_FILTRO_tid = k_thread_create(&thread_PWM_data, thread_PWM_stack,
+    thread_PWM_tid = k_thread_create(&thread_PWM_data, thread_PWM_stack,
         K_THREAD_STACK_SIZEOF(thread_PWM_stack), thread_PWM_code,
-        NULL, NULL, NULL, thread_PWM_prio, 0, K_NO_WAIT); 
+        NULL, NULL, NULL, thread_PWM_prio, 0, K_NO_WAIT);
+
+    /* Track CPU usage and stack high-water mark of the pipeline threads */
+    thread_stats_register(thread_ADC_tid, "ADC");
+    thread_stats_register(thread_FILTRO_tid, "FILTRO");
+    thread_stats_register(thread_PWM_tid, "PWM");
+
+    /* Priorities and timeslicing of the pipeline threads */
+    sched_profile_register(SCHED_STAGE_ADC, thread_ADC_tid);
+    sched_profile_register(SCHED_STAGE_FILTRO, thread_FILTRO_tid);
+    sched_profile_register(SCHED_STAGE_PWM, thread_PWM_tid);
+    sched_profile_apply(sched_profile_default());
 
     return;
 }
 
 /* Thread code implementation */
+#ifdef CONFIG_APP_ADC_LIMIT
+/* Event-driven acquisition: the SAADC samples on its own, see adc_limit.h */
+void thread_ADC_code(void *argA , void *argB, void *argC)
+{
+    int err;
+
+    printk("Thread A init (event-driven, SAADC limit events)\n");
+
+    err = pipeline_limit_run();
+    printk("adc_limit_run() failed with error code %d\n\r", err);
+}
+#else
 void thread_ADC_code(void *argA , void *argB, void *argC)
 {
   /* Timing variables to control task periodicity */
     int64_t fin_time=0, release_time=0;
+    uint32_t release_cyc=0, ideal_release_cyc=0;
+    uint32_t period_ms=0;
+    struct pipeline_cfg cfg;
 
     /* Other variables */
     long int nact = 0;
+    struct handoff_msg msg;
     
     printk("Thread A init (periodic)\n");
 
@@ -156,173 +150,106 @@ void thread_ADC_code(void *argA , void *argB, void *argC)
 
     /* Welcome message */
     printk("\n\r Simple adc demo for  \n\r");
-    printk(" Reads an analog input connected to AN%d and prints its raw and mV value \n\r", ADC_CHANNEL_ID);
+    printk(" Reads an analog input connected to AN%d and prints its raw and mV value \n\r", PIPELINE_ADC_CHANNEL_ID);
     printk(" *** ASSURE THAT ANx IS BETWEEN [0...3V]\n\r");
+
          
-    /* ADC setup: bind and initialize */
-    adc_dev = device_get_binding(DT_LABEL(ADC_NID));
-	if (!adc_dev) {
-        printk("ADC device_get_binding() failed\n");
-    } 
-    err = adc_channel_setup(adc_dev, &my_channel_cfg);
-    if (err) {
-        printk("adc_channel_setup() failed with error code %d\n", err);
+    if (pipeline_adc_setup()) {
+        return;
+    }
+
+    if (replay_enabled() && replay_open()) {
+        printk("replay: no trace available, acquisition stopped\n\r");
+        return;
+    }
+
+    /* Saturation test: sweep the sampling rate instead of the periodic loop */
+    if (stress_enabled()) {
+        stress_run("Semaphores", pipeline_stress_sample);
+        return;
     }
-    
-    /* It is recommended to calibrate the SAADC at least once before use, and whenever the ambient temperature has changed by more than 10 °C */
-    NRF_SAADC->TASKS_CALIBRATEOFFSET = 1;
  
  //#######################################################
     
 
     /* Compute next release instant */
-    release_time = k_uptime_get() + thread_ADC_period;
+    pipeline_cfg_get(&cfg);
+    period_ms = cfg.adc_period_ms;
+    release_time = k_uptime_get() + period_ms;
+    ideal_release_cyc = k_cycle_get_32();
 
     while(1) {
-//#######################################################
-        err=adc_sample();
-        val_1=(uint16_t)(1000*adc_sample_buffer[0]*((float)3/1023));
-        
-        if(err) 
-        {
-            printk("adc_sample() failed with error code %d\n\r",err);
+        /* Staged configuration changes take effect at a period boundary */
+        if (pipeline_cfg_apply()) {
+            pipeline_cfg_get(&cfg);
+            period_ms = cfg.adc_period_ms;
+            printk("New configuration applied, period %u ms\n\r", period_ms);
         }
-        else 
-        {
-            if(adc_sample_buffer[0] > 1023) 
-            {
-                printk("adc reading out of range\n\r");
-            }
-            else 
-            {
-                /* ADC is set to use gain of 1/4 and reference VDD/4, so input range is 0...VDD (3 V), with 10 bit resolution */
-                printk("adc reading: raw:%4u / %4u mV: \n\r",adc_sample_buffer[0],(uint16_t)(1000*adc_sample_buffer[0]*((float)3/1023)));
-            }
+
+        /* Release jitter against the ideal sampling period grid */
+        release_cyc = k_cycle_get_32();
+        latency_hist_record(&hist_adc_jitter, ideal_release_cyc, release_cyc);
+        ideal_release_cyc += k_ms_to_cyc_floor32(period_ms);
+
+        err = pipeline_adc_step(&msg, release_cyc);
+        if (err == -ENODATA) {
+            replay_finish();
+            return;
         }
-//#######################################################
-        
+
         /* Do the workload */          
-        printk("\n\nThread A instance %ld released at time: %lld (ms). \n",++nact, k_uptime_get());    
+        if (IS_ENABLED(CONFIG_APP_SAMPLE_LOG)) {
+            printk("\n\nThread A instance %ld released at time: %lld (ms). \n",++nact, k_uptime_get());
+        }
 
-        k_sem_give(&sem_val_1);
+        handoff_sem_put(&sem_val_1, &msg);
+        spectrum_push(msg.data);
 
        
-        /* Wait for next release instant */ 
+        /* Replay: release the next sample as soon as PWM consumed this one */
+        if (replay_enabled()) {
+            replay_wait_done();
+            continue;
+        }
+
+        /* Wait for next release instant (absolute, so preemption here adds no drift).
+         * The grid always advances: after an overrun the next release is immediate. */
         fin_time = k_uptime_get();
         if( fin_time < release_time) {
-            k_msleep(release_time - fin_time);
-            release_time += thread_ADC_period;
-
+            k_sleep(K_TIMEOUT_ABS_MS(release_time));
         }
+        release_time += period_ms;
     }
 
 }
+#endif /* CONFIG_APP_ADC_LIMIT */
 
 void thread_FILTRO_code(void *argA , void *argB, void *argC)
 {
     /* Other variables */
     long int nact = 0;
+    struct handoff_msg msg;
+    struct pipeline_cfg cfg;
+    struct filter filt;
+
+    pipeline_cfg_get(&cfg);
+    filter_init(&filt, cfg.filter_window);
 
     printk("Thread B init (sporadic, waits on a semaphore by task A)\n");
     while(1) {
-        k_sem_take(&sem_val_1,  K_FOREVER);
-        printk("Thread B instance %ld released at time: %lld (ms). \n",++nact, k_uptime_get());  
-        
-        /* Get one sample, checks for errors and prints the values */
-
-        /*if(ctrl_10<10)
-        {
-          array[ctrl_10]=val_1;
+        handoff_sem_get(&sem_val_1, &msg);
+        if (IS_ENABLED(CONFIG_APP_SAMPLE_LOG) && !stress_enabled()) {
+            printk("Thread B instance %ld released at time: %lld (ms). \n",++nact, k_uptime_get());
         }
-        else if(ctrl_10==10)
-        {
-          for(int i=0;i<10;i++)
-          {
-            sum+=array[i];
-            media=sum/10;
-          }
-          desvio=media*0.1;
-        }
-
-        else
-        {
-          for(int j=0;j<10;j++)
-          {
-            if(array[j]>=(media-desvio) && array[j]<=(media+desvio))
-            {
-              array_final_10[ctrl_final_10]=array[j];
-              ctrl_final_10++;
-            }
-          }
-          
-          while(ctrl_final_10<10)
-          {
-            array[l]=val_1;
-            l++;
-            if(l>=10)
-            {
-              l=0;
-            }
-            
-            for(int i=0;i<10;i++)
-            {
-             sum+=array[i];
-             media=sum/10;
-            }
-
-            double desvio=media*0.1;
-
-            for(int j=0;j<10;j++)
-            {
-              if(array[j]>=(media-desvio) && array[j]<=(media+desvio))
-              {
-                array_final_10[ctrl_final_10]=array[j];
-                ctrl_final_10++;
-              }
-            }
-          }
-
-          if(ctrl_final_10>=10)
-          {
-            array[l]=val_1;
-            l++;
-            if(l>=10)
-            {
-              l=0;
-            }
-            
-            for(int i=0;i<10;i++)
-            {
-             sum+=array[i];
-             media=sum/10;
-            }
-
-            double desvio=media*0.1;
-
-            for(int j=0;j<10;j++)
-            {
-              if(array[j]>=(media-desvio) && array[j]<=(media+desvio))
-              {
-                array_final_10[x]=array[j];
-                x++;
-                if(x>=10)
-                {
-                 x=0;
-                }
-                for(int i=0;i<10;i++)
-                {
-                  sum+=array_final_10[i];
-                  media_final=sum/10;
-                }
-              }
-            }
-
-          }
-        
-        ctrl_10++;
-        */
 
-        k_sem_give(&sem_media_final);
+        pipeline_filter_step(&filt, &msg, &msg);
+#ifdef CONFIG_APP_FANIN
+        /* This pipeline is input 0 of the fan-in stage */
+        fanin_put(FANIN_INPUT_FILTRO, &msg);
+#else
+        handoff_sem_put(&sem_media_final, &msg);
+#endif
+        chan_publish(&chan_filtered, &msg);
 
   }
 }
@@ -332,12 +259,9 @@ void thread_PWM_code(void *argA , void *argB, void *argC)
 {
     /* Other variables */
     long int nact = 0;
+    struct handoff_msg msg;
     
     const struct device *pwm0_dev;          /* Pointer to PWM device structure */
-    int ret_pwm=0;                          /* Generic return value variable */
-    
-    unsigned int pwmPeriod_us = 1000;       /* PWM priod in us */
-    unsigned int val_duty=0;
 
     pwm0_dev = device_get_binding(DT_LABEL(PWM0_NID));
     if (pwm0_dev == NULL) {
@@ -350,33 +274,17 @@ void thread_PWM_code(void *argA , void *argB, void *argC)
 
     printk("Thread C init (sporadic, waits on a semaphore by task A)\n");
     while(1) {
-        k_sem_take(&sem_media_final, K_FOREVER);
-        printk("Thread C instance %5ld released at time: %lld (ms). \n",++nact, k_uptime_get());          
+#ifdef CONFIG_APP_FANIN
+        fanin_get(&msg);
+#else
+        handoff_sem_get(&sem_media_final, &msg);
+#endif
+        if (IS_ENABLED(CONFIG_APP_SAMPLE_LOG) && !stress_enabled()) {
+            printk("Thread C instance %5ld released at time: %lld (ms). \n",++nact, k_uptime_get());
+        }
 
-         val_duty=((uint16_t)(1000*adc_sample_buffer[0]*((float)3/1023))*100)/3000;
-        printk("PWM DC value set to %u %%\n\r",val_duty);
-        
-        ret_pwm = pwm_pin_set_usec(pwm0_dev, BOARDLED_PIN,
-          pwmPeriod_us,val_duty, PWM_POLARITY_NORMAL);
-       /* if (ret_pwm) 
-        {
-            printk("Error %d: failed to set pulse width\n", ret_pwm);
-            return;
-        }*/
+        pipeline_pwm_step(pwm0_dev, &msg);
         
   }
 }
 
-
-
-
-
-
-    /* Main loop */
-    /*int sum=0;
-    int media=0;
-    int media_final=0;
-    double desvio=0;
-    int ctrl_final_10=0;
-    int l=0;
-    int x=0;*/
@@ -0,0 +1,102 @@
+/*
+ * Adaptive sampling rate
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <shell/shell.h>
+#include <stdlib.h>
+
+#include "adaptive_rate.h"
+#include "pipeline_cfg.h"
+#include "filter.h"
+
+/* Input mean/variance: exponential average over about 8 samples */
+#define ARATE_EWMA_SHIFT 3
+
+static bool have_last;
+static uint16_t last_filtered;
+static int32_t mean_q4;         /* input mean, mV << 4 */
+static uint32_t var;            /* input variance, mV^2 */
+static uint32_t slope;          /* filtered rate of change, mV/s */
+static uint32_t quiet;          /* consecutive quiet samples */
+static uint32_t n_faster, n_slower;
+
+/* Window spanning CONFIG_APP_ADAPTIVE_RATE_TAU_MS at 'period_ms' */
+static uint32_t arate_window(uint32_t period_ms)
+{
+    uint32_t window = (CONFIG_APP_ADAPTIVE_RATE_TAU_MS + period_ms / 2) / period_ms;
+
+    return CLAMP(window, 1, FILTER_WINDOW_MAX);
+}
+
+static void arate_stage(uint32_t period_ms)
+{
+    struct pipeline_cfg cfg;
+
+    pipeline_cfg_staged_get(&cfg);
+    cfg.adc_period_ms = period_ms;
+    cfg.filter_window = arate_window(period_ms);
+    pipeline_cfg_set(&cfg);
+}
+
+void adaptive_rate_update(uint16_t sample, uint16_t filtered)
+{
+    struct pipeline_cfg cfg;
+    uint32_t period_ms;
+    int32_t diff;
+
+    pipeline_cfg_get(&cfg);
+    period_ms = cfg.adc_period_ms;
+
+    /* Input variance around its running mean */
+    if (!have_last) {
+        mean_q4 = (int32_t)sample << 4;
+    }
+    mean_q4 += (((int32_t)sample << 4) - mean_q4) / (1 << ARATE_EWMA_SHIFT);
+    diff = (int32_t)sample - (mean_q4 >> 4);
+    var = (uint32_t)((int32_t)var + ((diff * diff) - (int32_t)var) / (1 << ARATE_EWMA_SHIFT));
+
+    /* Rate of change of the filtered value */
+    slope = have_last ? (uint32_t)abs((int32_t)filtered - last_filtered) * 1000U / period_ms : 0;
+    last_filtered = filtered;
+    have_last = true;
+
+    if (slope >= CONFIG_APP_ADAPTIVE_RATE_SLOPE_MV_S || var >= CONFIG_APP_ADAPTIVE_RATE_VAR_MV2) {
+        quiet = 0;
+        if (period_ms > CONFIG_APP_ADAPTIVE_RATE_MIN_MS) {
+            arate_stage(MAX(period_ms / 2, CONFIG_APP_ADAPTIVE_RATE_MIN_MS));
+            n_faster++;
+        }
+    } else if (slope < CONFIG_APP_ADAPTIVE_RATE_SLOPE_MV_S / 2 &&
+               var < CONFIG_APP_ADAPTIVE_RATE_VAR_MV2 / 2) {
+        if (++quiet >= CONFIG_APP_ADAPTIVE_RATE_QUIET_SAMPLES &&
+            period_ms < CONFIG_APP_ADAPTIVE_RATE_MAX_MS) {
+            arate_stage(MIN(period_ms * 2, CONFIG_APP_ADAPTIVE_RATE_MAX_MS));
+            n_slower++;
+            quiet = 0;
+        }
+    } else {
+        quiet = 0;
+    }
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_arate(const struct shell *sh, size_t argc, char **argv)
+{
+    struct pipeline_cfg cfg;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    pipeline_cfg_get(&cfg);
+    shell_print(sh, "period %u ms (%u..%u), window %u", cfg.adc_period_ms,
+        CONFIG_APP_ADAPTIVE_RATE_MIN_MS, CONFIG_APP_ADAPTIVE_RATE_MAX_MS, cfg.filter_window);
+    shell_print(sh, "slope %u mV/s (limit %u), variance %u mV^2 (limit %u), quiet %u",
+        slope, CONFIG_APP_ADAPTIVE_RATE_SLOPE_MV_S, var, CONFIG_APP_ADAPTIVE_RATE_VAR_MV2, quiet);
+    shell_print(sh, "rate raised %u times, lowered %u times", n_faster, n_slower);
+    return 0;
+}
+
+SHELL_CMD_REGISTER(arate, NULL, "Adaptive sampling rate state", cmd_arate);
+#endif /* CONFIG_SHELL */
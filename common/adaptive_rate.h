@@ -0,0 +1,37 @@
+/*
+ * Adaptive sampling rate
+ *
+ * FILTRO feeds every input sample and its filtered value. When the
+ * filtered signal moves faster than CONFIG_APP_ADAPTIVE_RATE_SLOPE_MV_S,
+ * or the input variance exceeds CONFIG_APP_ADAPTIVE_RATE_VAR_MV2, the
+ * sampling period is halved; after CONFIG_APP_ADAPTIVE_RATE_QUIET_SAMPLES
+ * samples below half of both thresholds it is doubled. The period stays
+ * within [CONFIG_APP_ADAPTIVE_RATE_MIN_MS, CONFIG_APP_ADAPTIVE_RATE_MAX_MS].
+ *
+ * The filter window follows the rate so that it keeps spanning
+ * CONFIG_APP_ADAPTIVE_RATE_TAU_MS (within 1..FILTER_WINDOW_MAX samples).
+ * Both go through pipeline_cfg_set(), so they change together at the
+ * next ADC period boundary.
+ */
+
+#ifndef ADAPTIVE_RATE_H
+#define ADAPTIVE_RATE_H
+
+#include <zephyr.h>
+
+#ifdef CONFIG_APP_ADAPTIVE_RATE
+
+/* Accounts for one sample (mV) and its filtered value; may stage a new rate */
+void adaptive_rate_update(uint16_t sample, uint16_t filtered);
+
+#else
+
+static inline void adaptive_rate_update(uint16_t sample, uint16_t filtered)
+{
+    ARG_UNUSED(sample);
+    ARG_UNUSED(filtered);
+}
+
+#endif /* CONFIG_APP_ADAPTIVE_RATE */
+
+#endif /* ADAPTIVE_RATE_H */
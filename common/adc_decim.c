@@ -0,0 +1,119 @@
+/*
+ * Decimating acquisition front end
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <shell/shell.h>
+#include <timing/timing.h>
+
+#include "adc_decim.h"
+#include "cic.h"
+#include "convert.h"
+
+#define DECIM_RATIO CONFIG_APP_ADC_DECIM_RATIO
+
+static struct cic cic;
+/* SAADC results are signed: a slightly negative input reads below 0 */
+static int16_t block[DECIM_RATIO];
+static uint16_t *decim_out;
+
+/* Cost of cic_process() per block, in CPU cycles (timing.h) */
+static uint32_t n_blocks;
+static uint64_t cycles_total;
+static uint32_t cycles_max;
+
+static enum adc_action decim_done(const struct device *dev,
+                                  const struct adc_sequence *seq,
+                                  uint16_t sampling_index)
+{
+    const uint16_t *in = (const uint16_t *)block;
+    timing_t t0, t1;
+    uint32_t cycles;
+    uint16_t out;
+
+    ARG_UNUSED(dev);
+    ARG_UNUSED(seq);
+
+    if (sampling_index < DECIM_RATIO - 1) {
+        return ADC_ACTION_CONTINUE;
+    }
+
+    /* Same clamp as adc_limit.c; 'in' aliases block as unsigned */
+    for (int i = 0; i < DECIM_RATIO; i++) {
+        block[i] = CLAMP(block[i], 0, ADC_MAX_RAW);
+    }
+
+    t0 = timing_counter_get();
+    if (cic_process(&cic, in, DECIM_RATIO, &out) == 1) {
+        *decim_out = out;
+    }
+    t1 = timing_counter_get();
+    cycles = (uint32_t)timing_cycles_get(&t0, &t1);
+
+    n_blocks++;
+    cycles_total += cycles;
+    if (cycles > cycles_max) {
+        cycles_max = cycles;
+    }
+    return ADC_ACTION_CONTINUE;
+}
+
+static const struct adc_sequence_options decim_options = {
+    .interval_us = CONFIG_APP_ADC_DECIM_INTERVAL_US,
+    .callback = decim_done,
+    .extra_samplings = DECIM_RATIO - 1,
+};
+
+int adc_decim_init(void)
+{
+    int err = cic_init(&cic, DECIM_RATIO, CONFIG_APP_ADC_DECIM_STAGES);
+
+    if (err) {
+        printk("adc_decim: ratio %u with %u stages overflows 32 bits\n\r",
+            DECIM_RATIO, CONFIG_APP_ADC_DECIM_STAGES);
+    }
+    n_blocks = 0;
+    cycles_total = 0;
+    cycles_max = 0;
+
+    /* The system clock (32 kHz RTC on nRF52) cannot resolve one block */
+    timing_init();
+    timing_start();
+    return err;
+}
+
+void adc_decim_attach(struct adc_sequence *seq, uint16_t *out)
+{
+    /* Every block ends on a decimator output (cic.phase stays 0) */
+    seq->options = &decim_options;
+    seq->buffer = block;
+    seq->buffer_size = sizeof(block);
+    decim_out = out;
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_decim(const struct shell *sh, size_t argc, char **argv)
+{
+    uint32_t n = n_blocks;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    shell_print(sh, "CIC ratio %u, %u stages, input interval %u us",
+        DECIM_RATIO, CONFIG_APP_ADC_DECIM_STAGES, CONFIG_APP_ADC_DECIM_INTERVAL_US);
+    if (n == 0) {
+        shell_print(sh, "no blocks yet");
+        return 0;
+    }
+    shell_print(sh, "%u blocks, %u.%02u cycles/input sample (worst block %u.%02u), %u MHz clock",
+        n,
+        (uint32_t)(cycles_total / ((uint64_t)n * DECIM_RATIO)),
+        (uint32_t)(cycles_total * 100 / ((uint64_t)n * DECIM_RATIO) % 100),
+        cycles_max / DECIM_RATIO, cycles_max * 100 / DECIM_RATIO % 100,
+        timing_freq_get_mhz());
+    return 0;
+}
+
+SHELL_CMD_REGISTER(decim, NULL, "ADC decimator cost", cmd_decim);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,46 @@
+/*
+ * Decimating acquisition front end
+ *
+ * Each adc_read() of the pipeline channel becomes a burst of
+ * CONFIG_APP_ADC_DECIM_RATIO conversions (extra_samplings), spaced
+ * CONFIG_APP_ADC_DECIM_INTERVAL_US apart or back to back when 0. When the
+ * last one completes, the sequence callback runs the block through a CIC
+ * decimator (cic.h) in the ADC completion context and leaves the single
+ * decimated sample where the pipeline expects its raw sample, so
+ * thread_FILTRO_code only sees the decimated rate.
+ *
+ * The decimator state carries over between reads, so the output is the
+ * continuous CIC response of the input stream. "decim" in the shell shows
+ * the cycles spent per input sample.
+ */
+
+#ifndef ADC_DECIM_H
+#define ADC_DECIM_H
+
+#include <zephyr.h>
+#include <drivers/adc.h>
+
+#ifdef CONFIG_APP_ADC_DECIM
+
+/* Resets the decimator */
+int adc_decim_init(void);
+
+/* Turns 'seq' into a decimated read whose output lands in *out */
+void adc_decim_attach(struct adc_sequence *seq, uint16_t *out);
+
+#else
+
+static inline int adc_decim_init(void)
+{
+    return 0;
+}
+
+static inline void adc_decim_attach(struct adc_sequence *seq, uint16_t *out)
+{
+    ARG_UNUSED(seq);
+    ARG_UNUSED(out);
+}
+
+#endif /* CONFIG_APP_ADC_DECIM */
+
+#endif /* ADC_DECIM_H */
@@ -0,0 +1,215 @@
+/*
+ * Event-driven acquisition with the SAADC limit events (nRF52)
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <shell/shell.h>
+#include <nrfx_ppi.h>
+#include <hal/nrf_saadc.h>
+#include <hal/nrf_timer.h>
+
+#include "adc_limit.h"
+#include "convert.h"
+
+#define LIMIT_TIMER NRF_TIMER1
+#define LIMIT_IRQ_PRIO 1
+
+static struct k_sem limit_sem;
+static uint8_t limit_ch;
+static volatile nrf_saadc_value_t limit_buf[1];
+
+/* Band exits and heartbeats delivered to the pipeline */
+static uint32_t n_exits;
+static uint32_t n_heartbeats;
+
+static nrf_saadc_gain_t limit_gain(enum adc_gain gain)
+{
+    switch (gain) {
+    case ADC_GAIN_1_6: return NRF_SAADC_GAIN1_6;
+    case ADC_GAIN_1_5: return NRF_SAADC_GAIN1_5;
+    case ADC_GAIN_1_4: return NRF_SAADC_GAIN1_4;
+    case ADC_GAIN_1_3: return NRF_SAADC_GAIN1_3;
+    case ADC_GAIN_1_2: return NRF_SAADC_GAIN1_2;
+    case ADC_GAIN_2: return NRF_SAADC_GAIN2;
+    case ADC_GAIN_4: return NRF_SAADC_GAIN4;
+    default: return NRF_SAADC_GAIN1;
+    }
+}
+
+static nrf_saadc_acqtime_t limit_acq_time(uint16_t acq)
+{
+    if (acq == ADC_ACQ_TIME_DEFAULT || ADC_ACQ_TIME_UNIT(acq) != ADC_ACQ_TIME_MICROSECONDS) {
+        return NRF_SAADC_ACQTIME_10US;
+    }
+
+    switch (ADC_ACQ_TIME_VALUE(acq)) {
+    case 3: return NRF_SAADC_ACQTIME_3US;
+    case 5: return NRF_SAADC_ACQTIME_5US;
+    case 15: return NRF_SAADC_ACQTIME_15US;
+    case 20: return NRF_SAADC_ACQTIME_20US;
+    case 40: return NRF_SAADC_ACQTIME_40US;
+    default: return NRF_SAADC_ACQTIME_10US;
+    }
+}
+
+static nrf_saadc_resolution_t limit_resolution(uint8_t bits)
+{
+    switch (bits) {
+    case 8: return NRF_SAADC_RESOLUTION_8BIT;
+    case 12: return NRF_SAADC_RESOLUTION_12BIT;
+    case 14: return NRF_SAADC_RESOLUTION_14BIT;
+    default: return NRF_SAADC_RESOLUTION_10BIT;
+    }
+}
+
+static void limit_disarm(void)
+{
+    nrf_saadc_channel_limits_set(NRF_SAADC, limit_ch, NRF_SAADC_LIMITL_DISABLED,
+        NRF_SAADC_LIMITH_DISABLED);
+}
+
+static void limit_isr(const void *arg)
+{
+    nrf_saadc_event_t high = nrf_saadc_limit_event_get(limit_ch, NRF_SAADC_LIMIT_HIGH);
+    nrf_saadc_event_t low = nrf_saadc_limit_event_get(limit_ch, NRF_SAADC_LIMIT_LOW);
+
+    ARG_UNUSED(arg);
+
+    if (nrf_saadc_event_check(NRF_SAADC, high) || nrf_saadc_event_check(NRF_SAADC, low)) {
+        nrf_saadc_event_clear(NRF_SAADC, high);
+        nrf_saadc_event_clear(NRF_SAADC, low);
+        /* Would fire on every conversion until FILTRO recentres the band */
+        limit_disarm();
+        k_sem_give(&limit_sem);
+    }
+}
+
+void adc_limit_recenter(uint16_t mv)
+{
+    int32_t center = (int32_t)mv * ADC_MAX_RAW / ADC_FULL_SCALE_MV;
+    int32_t band = CONFIG_APP_ADC_LIMIT_BAND_MV * ADC_MAX_RAW / ADC_FULL_SCALE_MV;
+
+    nrf_saadc_channel_limits_set(NRF_SAADC, limit_ch,
+        (int16_t)MAX(center - band, NRF_SAADC_LIMITL_DISABLED),
+        (int16_t)MIN(center + band, NRF_SAADC_LIMITH_DISABLED));
+}
+
+static int limit_ppi_connect(uint32_t event, uint32_t task)
+{
+    nrf_ppi_channel_t ch;
+
+    if (nrfx_ppi_channel_alloc(&ch) != NRFX_SUCCESS) {
+        return -EBUSY;
+    }
+    nrfx_ppi_channel_assign(ch, event, task);
+    nrfx_ppi_channel_enable(ch);
+    return 0;
+}
+
+static int limit_setup(const struct adc_channel_cfg *cfg, uint8_t input, uint8_t resolution)
+{
+    nrf_saadc_channel_config_t ch_cfg = {
+        .resistor_p = NRF_SAADC_RESISTOR_DISABLED,
+        .resistor_n = NRF_SAADC_RESISTOR_DISABLED,
+        .gain = limit_gain(cfg->gain),
+        .reference = cfg->reference == ADC_REF_INTERNAL ?
+            NRF_SAADC_REFERENCE_INTERNAL : NRF_SAADC_REFERENCE_VDD4,
+        .acq_time = limit_acq_time(cfg->acquisition_time),
+        .mode = NRF_SAADC_MODE_SINGLE_ENDED,
+        .burst = NRF_SAADC_BURST_DISABLED,
+    };
+    int err;
+
+    limit_ch = cfg->channel_id;
+    k_sem_init(&limit_sem, 0, 1);
+
+    nrf_saadc_enable(NRF_SAADC);
+    nrf_saadc_resolution_set(NRF_SAADC, limit_resolution(resolution));
+    nrf_saadc_oversample_set(NRF_SAADC, NRF_SAADC_OVERSAMPLE_DISABLED);
+    nrf_saadc_channel_init(NRF_SAADC, limit_ch, &ch_cfg);
+    nrf_saadc_channel_input_set(NRF_SAADC, limit_ch, input, NRF_SAADC_INPUT_DISABLED);
+    limit_disarm();
+
+    /* Same one-off calibration as the polled path */
+    nrf_saadc_event_clear(NRF_SAADC, NRF_SAADC_EVENT_CALIBRATEDONE);
+    nrf_saadc_task_trigger(NRF_SAADC, NRF_SAADC_TASK_CALIBRATEOFFSET);
+    while (!nrf_saadc_event_check(NRF_SAADC, NRF_SAADC_EVENT_CALIBRATEDONE)) {
+    }
+
+    /* Sampling clock: TIMER1 at 1 MHz, COMPARE0 -> SAMPLE */
+    nrf_timer_mode_set(LIMIT_TIMER, NRF_TIMER_MODE_TIMER);
+    nrf_timer_bit_width_set(LIMIT_TIMER, NRF_TIMER_BIT_WIDTH_32);
+    nrf_timer_frequency_set(LIMIT_TIMER, NRF_TIMER_FREQ_1MHz);
+    nrf_timer_cc_set(LIMIT_TIMER, NRF_TIMER_CC_CHANNEL0, 1000000U / CONFIG_APP_ADC_LIMIT_RATE_HZ);
+    nrf_timer_shorts_enable(LIMIT_TIMER, NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK);
+
+    err = limit_ppi_connect(nrf_timer_event_address_get(LIMIT_TIMER, NRF_TIMER_EVENT_COMPARE0),
+        nrf_saadc_task_address_get(NRF_SAADC, NRF_SAADC_TASK_SAMPLE));
+    if (!err) {
+        /* The SAADC has no shorts: END re-arms the buffer through PPI */
+        err = limit_ppi_connect(nrf_saadc_event_address_get(NRF_SAADC, NRF_SAADC_EVENT_END),
+            nrf_saadc_task_address_get(NRF_SAADC, NRF_SAADC_TASK_START));
+    }
+    if (err) {
+        return err;
+    }
+
+    nrf_saadc_int_disable(NRF_SAADC, NRF_SAADC_INT_ALL);
+    nrf_saadc_int_enable(NRF_SAADC, nrf_saadc_limit_int_get(limit_ch, NRF_SAADC_LIMIT_HIGH) |
+        nrf_saadc_limit_int_get(limit_ch, NRF_SAADC_LIMIT_LOW));
+    IRQ_CONNECT(SAADC_IRQn, LIMIT_IRQ_PRIO, limit_isr, NULL, 0);
+    irq_enable(SAADC_IRQn);
+
+    nrf_saadc_buffer_init(NRF_SAADC, (nrf_saadc_value_t *)limit_buf, 1);
+    nrf_saadc_task_trigger(NRF_SAADC, NRF_SAADC_TASK_START);
+    nrf_timer_task_trigger(LIMIT_TIMER, NRF_TIMER_TASK_CLEAR);
+    nrf_timer_task_trigger(LIMIT_TIMER, NRF_TIMER_TASK_START);
+
+    return 0;
+}
+
+int adc_limit_run(const struct adc_channel_cfg *cfg, uint8_t input,
+    uint8_t resolution, adc_limit_sample_fn sample)
+{
+    int err;
+
+    err = limit_setup(cfg, input, resolution);
+    if (err) {
+        printk("adc_limit: setup failed (%d)\n\r", err);
+        return err;
+    }
+    printk("adc_limit: sampling at %d Hz, band +/-%d mV, heartbeat %d ms\n\r",
+        CONFIG_APP_ADC_LIMIT_RATE_HZ, CONFIG_APP_ADC_LIMIT_BAND_MV,
+        CONFIG_APP_ADC_LIMIT_HEARTBEAT_MS);
+
+    /* First conversion goes through unconditionally, FILTRO then arms the band */
+    k_msleep(2 * 1000 / CONFIG_APP_ADC_LIMIT_RATE_HZ + 1);
+    n_heartbeats++;
+    sample((uint16_t)MAX(limit_buf[0], 0));
+
+    while (1) {
+        if (k_sem_take(&limit_sem, K_MSEC(CONFIG_APP_ADC_LIMIT_HEARTBEAT_MS)) != 0) {
+            n_heartbeats++;
+        } else {
+            n_exits++;
+        }
+        sample((uint16_t)MAX(limit_buf[0], 0));
+    }
+
+    return 0;
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_adclimit(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    shell_print(sh, "band exits %u, heartbeats %u, last raw %d", n_exits, n_heartbeats,
+        limit_buf[0]);
+    return 0;
+}
+
+SHELL_CMD_REGISTER(adclimit, NULL, "Event-driven acquisition counters", cmd_adclimit);
+#endif /* CONFIG_SHELL */
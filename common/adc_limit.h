@@ -0,0 +1,58 @@
+/*
+ * Event-driven acquisition with the SAADC limit events (nRF52)
+ *
+ * The SAADC samples autonomously: TIMER1 triggers SAMPLE through PPI at
+ * CONFIG_APP_ADC_LIMIT_RATE_HZ, and END restarts the single-sample
+ * buffer through a second PPI channel, so no CPU is involved per sample.
+ * The channel's LIMITH/LIMITL events are armed on a band of
+ * +/- CONFIG_APP_ADC_LIMIT_BAND_MV around the last filtered value; only
+ * a band exit (or the heartbeat, every CONFIG_APP_ADC_LIMIT_HEARTBEAT_MS)
+ * wakes thread_ADC_code, which hands the latest conversion downstream.
+ * The band is disarmed on exit and re-armed when FILTRO recentres it.
+ *
+ * The channel is configured from the application's adc_channel_cfg; the
+ * Zephyr SAADC driver must be disabled (see common/conf/adc_limit.conf).
+ */
+
+#ifndef ADC_LIMIT_H
+#define ADC_LIMIT_H
+
+#include <zephyr.h>
+#include <drivers/adc.h>
+
+/* Hands one raw conversion downstream */
+typedef void (*adc_limit_sample_fn)(uint16_t raw);
+
+#ifdef CONFIG_APP_ADC_LIMIT
+
+/*
+ * Configures the SAADC channel 'cfg' on analog input 'input'
+ * (NRF_SAADC_INPUT_AINx), starts autonomous sampling and calls 'sample'
+ * on every band exit and heartbeat. Does not return unless setup fails.
+ */
+int adc_limit_run(const struct adc_channel_cfg *cfg, uint8_t input,
+    uint8_t resolution, adc_limit_sample_fn sample);
+
+/* Re-arms the band around 'mv' (called by FILTRO with its output) */
+void adc_limit_recenter(uint16_t mv);
+
+#else
+
+static inline int adc_limit_run(const struct adc_channel_cfg *cfg, uint8_t input,
+    uint8_t resolution, adc_limit_sample_fn sample)
+{
+    ARG_UNUSED(cfg);
+    ARG_UNUSED(input);
+    ARG_UNUSED(resolution);
+    ARG_UNUSED(sample);
+    return -ENOTSUP;
+}
+
+static inline void adc_limit_recenter(uint16_t mv)
+{
+    ARG_UNUSED(mv);
+}
+
+#endif /* CONFIG_APP_ADC_LIMIT */
+
+#endif /* ADC_LIMIT_H */
@@ -0,0 +1,172 @@
+/*
+ * Scripted input waveforms for the ADC emulator
+ */
+
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/adc.h>
+#include <drivers/adc/adc_emul.h>
+#include <random/rand32.h>
+#include <shell/shell.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include "adc_waveform.h"
+
+/* Input range of the pipeline: VDD with gain 1/4 and reference VDD/4 */
+#define ADC_WAVEFORM_VDD_MV 3000
+
+static struct adc_waveform wave = {
+    .type = ADC_WAVEFORM_SINE,
+    .offset_mv = ADC_WAVEFORM_VDD_MV / 2,
+    .amplitude_mv = ADC_WAVEFORM_VDD_MV / 4,
+    .period_ms = 20000,
+};
+static struct k_spinlock wave_lock;
+
+static const char *const wave_names[] = {
+    [ADC_WAVEFORM_CONST] = "const",
+    [ADC_WAVEFORM_SINE] = "sine",
+    [ADC_WAVEFORM_SQUARE] = "square",
+    [ADC_WAVEFORM_RAMP] = "ramp",
+    [ADC_WAVEFORM_NOISE] = "noise",
+};
+
+uint32_t adc_waveform_value(uint32_t t_ms)
+{
+    struct adc_waveform w;
+    uint32_t phase;
+    int32_t dev = 0;
+    k_spinlock_key_t key = k_spin_lock(&wave_lock);
+
+    w = wave;
+    k_spin_unlock(&wave_lock, key);
+
+    phase = w.period_ms ? t_ms % w.period_ms : 0;
+
+    switch (w.type) {
+    case ADC_WAVEFORM_SINE:
+        dev = (int32_t)(w.amplitude_mv * sin(2.0 * M_PI * phase / w.period_ms));
+        break;
+    case ADC_WAVEFORM_SQUARE:
+        dev = phase < w.period_ms / 2 ? (int32_t)w.amplitude_mv : -(int32_t)w.amplitude_mv;
+        break;
+    case ADC_WAVEFORM_RAMP:
+        dev = (int32_t)((2 * (uint64_t)w.amplitude_mv * phase) / w.period_ms) - (int32_t)w.amplitude_mv;
+        break;
+    case ADC_WAVEFORM_NOISE:
+        dev = (int32_t)(sys_rand32_get() % (2 * w.amplitude_mv + 1)) - (int32_t)w.amplitude_mv;
+        break;
+    default:
+        break;
+    }
+
+    return (uint32_t)CLAMP((int32_t)w.offset_mv + dev, 0, ADC_WAVEFORM_VDD_MV);
+}
+
+static int adc_waveform_emul_value(const struct device *dev, unsigned int chan,
+                                   void *data, uint32_t *result)
+{
+    ARG_UNUSED(dev);
+    ARG_UNUSED(chan);
+    ARG_UNUSED(data);
+
+    *result = adc_waveform_value(k_uptime_get_32());
+    return 0;
+}
+
+int adc_waveform_attach(const struct device *adc, unsigned int channel)
+{
+    int err;
+
+    err = adc_emul_ref_voltage_set(adc, ADC_REF_VDD_1, ADC_WAVEFORM_VDD_MV);
+    if (err) {
+        printk("adc_emul_ref_voltage_set() failed with code %d\n\r", err);
+        return err;
+    }
+
+    err = adc_emul_value_func_set(adc, channel, adc_waveform_emul_value, NULL);
+    if (err) {
+        printk("adc_emul_value_func_set() failed with code %d\n\r", err);
+    }
+    return err;
+}
+
+int adc_waveform_set(const struct adc_waveform *w)
+{
+    uint32_t swing = w->type == ADC_WAVEFORM_CONST ? 0 : w->amplitude_mv;
+    k_spinlock_key_t key;
+
+    /* The whole swing must fit in the ADC input range */
+    if (w->type > ADC_WAVEFORM_NOISE || w->period_ms == 0 ||
+        w->offset_mv > ADC_WAVEFORM_VDD_MV || swing > w->offset_mv ||
+        w->offset_mv + swing > ADC_WAVEFORM_VDD_MV) {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&wave_lock);
+    wave = *w;
+    k_spin_unlock(&wave_lock, key);
+
+    return 0;
+}
+
+#ifdef CONFIG_SHELL
+/* Parses an unsigned decimal or hex argument */
+static int wave_arg(const char *arg, uint32_t *val)
+{
+    char *end;
+    unsigned long v;
+
+    errno = 0;
+    v = strtoul(arg, &end, 0);
+    if (end == arg || *end != '\0' || errno || v > UINT32_MAX) {
+        return -EINVAL;
+    }
+    *val = (uint32_t)v;
+    return 0;
+}
+
+static int cmd_wave(const struct shell *sh, size_t argc, char **argv)
+{
+    struct adc_waveform w = wave;
+    int i;
+
+    if (argc < 2) {
+        shell_print(sh, "%s offset %u mV amplitude %u mV period %u ms",
+            wave_names[wave.type], wave.offset_mv, wave.amplitude_mv, wave.period_ms);
+        return 0;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(wave_names); i++) {
+        if (!strcmp(argv[1], wave_names[i])) {
+            break;
+        }
+    }
+    if (i == ARRAY_SIZE(wave_names)) {
+        shell_error(sh, "unknown waveform %s", argv[1]);
+        return -EINVAL;
+    }
+
+    w.type = i;
+    if ((argc > 2 && wave_arg(argv[2], &w.offset_mv)) ||
+        (argc > 3 && wave_arg(argv[3], &w.amplitude_mv)) ||
+        (argc > 4 && wave_arg(argv[4], &w.period_ms))) {
+        shell_error(sh, "invalid number");
+        return -EINVAL;
+    }
+    if (adc_waveform_set(&w)) {
+        shell_error(sh, "out of range: period >= 1 ms, offset +/- amplitude within 0..%u mV",
+            ADC_WAVEFORM_VDD_MV);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(wave, NULL,
+    "Emulated ADC input: wave [const|sine|square|ramp|noise] [offset_mv] [amplitude_mv] [period_ms]",
+    cmd_wave, 1, 4);
+#endif /* CONFIG_SHELL */
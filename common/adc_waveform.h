@@ -0,0 +1,54 @@
+/*
+ * Scripted input waveforms for the ADC emulator
+ *
+ * On native_posix the "adc" node is the Zephyr ADC emulator. This module
+ * feeds the pipeline channel with a synthetic signal (constant, sine,
+ * square, ramp or noise), selectable at run time with the "wave" shell
+ * command, so the filter and PWM stages see a known input.
+ */
+
+#ifndef ADC_WAVEFORM_H
+#define ADC_WAVEFORM_H
+
+#include <zephyr.h>
+#include <device.h>
+
+enum adc_waveform_type {
+    ADC_WAVEFORM_CONST,
+    ADC_WAVEFORM_SINE,
+    ADC_WAVEFORM_SQUARE,
+    ADC_WAVEFORM_RAMP,
+    ADC_WAVEFORM_NOISE,
+};
+
+struct adc_waveform {
+    enum adc_waveform_type type;
+    uint32_t offset_mv;         /* mean level */
+    uint32_t amplitude_mv;      /* peak deviation from the mean */
+    uint32_t period_ms;         /* sine/square/ramp period */
+};
+
+#ifdef CONFIG_APP_ADC_WAVEFORM
+
+/* Attaches the waveform generator to an emulated ADC channel */
+int adc_waveform_attach(const struct device *adc, unsigned int channel);
+
+/* Replaces the current waveform; -EINVAL if it leaves the ADC input range
+ * or has a zero period */
+int adc_waveform_set(const struct adc_waveform *wave);
+
+/* Value of the current waveform (mV) at time t_ms */
+uint32_t adc_waveform_value(uint32_t t_ms);
+
+#else
+
+static inline int adc_waveform_attach(const struct device *adc, unsigned int channel)
+{
+    ARG_UNUSED(adc);
+    ARG_UNUSED(channel);
+    return 0;
+}
+
+#endif /* CONFIG_APP_ADC_WAVEFORM */
+
+#endif /* ADC_WAVEFORM_H */
@@ -0,0 +1,36 @@
+/*
+ * Console output shared by the shell commands and the periodic/boot dumps
+ *
+ * app_print() prints one line to 'sh' when it is set (a shell command)
+ * and with printk otherwise, so each module keeps a single printer.
+ */
+
+#ifndef APP_PRINT_H
+#define APP_PRINT_H
+
+#include <zephyr.h>
+#include <sys/printk.h>
+
+#ifdef CONFIG_SHELL
+#include <shell/shell.h>
+
+#define app_print(sh, fmt, ...) do {                        \
+        if ((sh) != NULL) {                                 \
+            shell_print(sh, fmt, ##__VA_ARGS__);            \
+        } else {                                            \
+            printk(fmt "\n\r", ##__VA_ARGS__);              \
+        }                                                   \
+    } while (0)
+
+#else
+
+struct shell;
+
+#define app_print(sh, fmt, ...) do {                        \
+        ARG_UNUSED(sh);                                     \
+        printk(fmt "\n\r", ##__VA_ARGS__);                  \
+    } while (0)
+
+#endif /* CONFIG_SHELL */
+
+#endif /* APP_PRINT_H */
@@ -0,0 +1,416 @@
+/*
+ * Host microbenchmark of the pipeline kernels
+ *
+ * Runs every variant of the conversion and filter kernels over a large
+ * synthetic input, reports ns/sample and heap allocations, and checks
+ * that all variants of a kernel give bit-identical output. Exits with 1
+ * on any mismatch. Decimators are timed per input sample; the waveform
+ * store is timed for encoding plus decoding, and checked against a copy.
+ * The fixed-point lifetime statistics are checked against double
+ * precision.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "convert.h"
+#include "filter.h"
+#include "stats.h"
+#include "cic.h"
+#include "wavecomp.h"
+
+#define BENCH_DEFAULT_SAMPLES (1u << 20)
+#define BENCH_REPEAT 5
+
+/* Heap allocation counter (--wrap=malloc/calloc/realloc) */
+static unsigned long n_allocs;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    n_allocs++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    n_allocs++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    n_allocs++;
+    return __real_realloc(ptr, size);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/* Kernel under test: processes n inputs into n outputs */
+struct bench_kernel {
+    const char *name;
+    void (*run)(const uint16_t *in, uint16_t *out, size_t n, unsigned int param);
+};
+
+static void run_raw_to_mv(const uint16_t *in, uint16_t *out, size_t n, unsigned int param)
+{
+    (void)param;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = convert_raw_to_mv(in[i]);
+    }
+}
+
+static void run_raw_to_mv_mulshift(const uint16_t *in, uint16_t *out, size_t n, unsigned int param)
+{
+    (void)param;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = convert_raw_to_mv_mulshift(in[i]);
+    }
+}
+
+static void run_raw_to_mv_float(const uint16_t *in, uint16_t *out, size_t n, unsigned int param)
+{
+    (void)param;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = convert_raw_to_mv_float(in[i]);
+    }
+}
+
+static void run_mv_to_duty(const uint16_t *in, uint16_t *out, size_t n, unsigned int param)
+{
+    (void)param;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = convert_mv_to_duty(in[i]);
+    }
+}
+
+static void run_mv_to_duty_mulshift(const uint16_t *in, uint16_t *out, size_t n, unsigned int param)
+{
+    (void)param;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = convert_mv_to_duty_mulshift(in[i]);
+    }
+}
+
+static void run_filter(const uint16_t *in, uint16_t *out, size_t n, unsigned int window)
+{
+    struct filter f;
+
+    filter_init(&f, window);
+    for (size_t i = 0; i < n; i++) {
+        out[i] = filter_update(&f, in[i]);
+    }
+}
+
+static void run_filter_ref(const uint16_t *in, uint16_t *out, size_t n, unsigned int window)
+{
+    struct filter f;
+
+    filter_init(&f, window);
+    for (size_t i = 0; i < n; i++) {
+        out[i] = filter_update_ref(&f, in[i]);
+    }
+}
+
+/* Window resized every FILTER_RESIZE_EVERY samples, alternating between
+ * the two windows of param (a | b << 8), as adaptive_rate.c and "pcfg
+ * window" do at run time */
+#define FILTER_RESIZE_EVERY 1000
+
+static void run_filter_resize(const uint16_t *in, uint16_t *out, size_t n, unsigned int param)
+{
+    struct filter f;
+
+    filter_init(&f, param & 0xff);
+    for (size_t i = 0; i < n; i++) {
+        if (i && i % FILTER_RESIZE_EVERY == 0) {
+            filter_set_window(&f, (i / FILTER_RESIZE_EVERY) % 2 ? param >> 8 : param & 0xff);
+        }
+        out[i] = filter_update(&f, in[i]);
+    }
+}
+
+/* Reference: a new filter fed again with the samples the old one held */
+static void run_filter_reinit(const uint16_t *in, uint16_t *out, size_t n, unsigned int param)
+{
+    struct filter f;
+    unsigned int window = param & 0xff;
+
+    filter_init(&f, window);
+    for (size_t i = 0; i < n; i++) {
+        if (i && i % FILTER_RESIZE_EVERY == 0) {
+            size_t held = i < window ? i : window;
+
+            window = (i / FILTER_RESIZE_EVERY) % 2 ? param >> 8 : param & 0xff;
+            filter_init(&f, window);
+            for (size_t j = i - held; j < i; j++) {
+                filter_update_ref(&f, in[j]);
+            }
+        }
+        out[i] = filter_update_ref(&f, in[i]);
+    }
+}
+
+/* Lifetime statistics of the stream against double precision: the fixed
+ * point mean must stay within STATS_MEAN_TOL and the variance within
+ * STATS_VAR_TOL (both Q8) at every checkpoint, min/max must be exact */
+#define STATS_CHECKPOINTS 16
+#define STATS_MEAN_TOL 1
+#define STATS_VAR_TOL 4
+
+static int check_stats(const char *group, const uint16_t *in, size_t n)
+{
+    struct stats_acc acc;
+    struct stats_snapshot snap;
+    double mean = 0, m2 = 0;
+    double err_mean = 0, err_var = 0;
+    uint16_t lo = UINT16_MAX, hi = 0;
+    size_t next = n / STATS_CHECKPOINTS;
+    int failed = 0;
+
+    stats_reset(&acc);
+    for (size_t i = 0; i < n; i++) {
+        double delta = in[i] - mean;
+
+        stats_add(&acc, in[i]);
+        mean += delta / (double)(i + 1);
+        m2 += delta * (in[i] - mean);
+        lo = in[i] < lo ? in[i] : lo;
+        hi = in[i] > hi ? in[i] : hi;
+
+        if (i + 1 < next && i + 1 < n) {
+            continue;
+        }
+        next += n / STATS_CHECKPOINTS;
+        stats_snapshot(&acc, &snap);
+        err_mean = fmax(err_mean, fabs(snap.mean_q8 - mean * 256));
+        err_var = fmax(err_var, fabs(snap.var_q8 - m2 / (double)(i + 1) * 256));
+        if (snap.count != i + 1 || snap.min != lo || snap.max != hi) {
+            failed = 1;
+        }
+    }
+    failed |= err_mean > STATS_MEAN_TOL || err_var > STATS_VAR_TOL;
+
+    printf("%-14s %-20s mean err %.3f, var err %.3f (Q8)  %s\n", group, "stats_add",
+        err_mean, err_var, failed ? "MISMATCH" : "within tolerance");
+    return failed;
+}
+
+/* CIC decimators: param is ratio | stages << 8; outputs past n / ratio are zeroed */
+static void run_cic(const uint16_t *in, uint16_t *out, size_t n, unsigned int param)
+{
+    struct cic c;
+    size_t n_out;
+
+    cic_init(&c, param & 0xff, param >> 8);
+    n_out = cic_process(&c, in, n, out);
+    memset(out + n_out, 0, (n - n_out) * sizeof(*out));
+}
+
+static void run_cic_ref(const uint16_t *in, uint16_t *out, size_t n, unsigned int param)
+{
+    size_t n_out = cic_decimate_ref(in, n, param & 0xff, param >> 8, out);
+
+    memset(out + n_out, 0, (n - n_out) * sizeof(*out));
+}
+
+/* Waveform store big enough for a whole run, allocated outside the timed part */
+static struct wave_chunk *wave_chunks;
+static uint32_t wave_n_chunks;
+static size_t wave_bytes;           /* chunk memory used by the last run */
+
+static void run_copy(const uint16_t *in, uint16_t *out, size_t n, unsigned int param)
+{
+    (void)param;
+    memcpy(out, in, n * sizeof(*out));
+}
+
+/* Stores the samples 1 ms apart, then decodes every chunk back */
+static void run_wavecomp(const uint16_t *in, uint16_t *out, size_t n, unsigned int param)
+{
+    struct wave_store s;
+    const struct wave_chunk *c;
+    size_t pos = 0;
+    uint32_t k;
+
+    (void)param;
+    wave_store_init(&s, wave_chunks, wave_n_chunks);
+    for (size_t i = 0; i < n; i++) {
+        wave_store_put(&s, (uint32_t)i, 1, in[i]);
+    }
+    for (k = 0; (c = wave_store_chunk(&s, k)) != NULL; k++) {
+        pos += wave_chunk_decode(c, out + pos, n - pos);
+    }
+    wave_bytes = k * sizeof(struct wave_chunk);
+}
+
+/* Runs all variants of one kernel; the first one is the reference output */
+static int bench_group(const char *group, const struct bench_kernel *k, int n_k,
+                       const uint16_t *in, size_t n, unsigned int param)
+{
+    uint16_t *ref = malloc(n * sizeof(*ref));
+    uint16_t *out = malloc(n * sizeof(*out));
+    int failed = 0;
+
+    for (int v = 0; v < n_k; v++) {
+        uint64_t best = UINT64_MAX;
+        unsigned long allocs;
+
+        allocs = n_allocs;
+        for (int r = 0; r < BENCH_REPEAT; r++) {
+            uint64_t t0 = now_ns();
+
+            k[v].run(in, v ? out : ref, n, param);
+            t0 = now_ns() - t0;
+            if (t0 < best) {
+                best = t0;
+            }
+        }
+        allocs = (n_allocs - allocs) / BENCH_REPEAT;
+
+        size_t mismatch = 0;
+        if (v) {
+            for (size_t i = 0; i < n; i++) {
+                mismatch += out[i] != ref[i];
+            }
+        }
+
+        printf("%-14s %-20s %8.3f ns/sample %6lu allocs  %s\n", group, k[v].name,
+            (double)best / n, allocs,
+            v == 0 ? "reference" : mismatch ? "MISMATCH" : "identical");
+        if (mismatch) {
+            printf("    %zu of %zu outputs differ from %s\n", mismatch, n, k[0].name);
+            failed = 1;
+        }
+    }
+
+    free(ref);
+    free(out);
+    return failed;
+}
+
+/* Slow sine-like ramp with noise and occasional spikes, in ADC raw units */
+static void make_input_raw(uint16_t *buf, size_t n)
+{
+    uint32_t lcg = 12345;
+
+    for (size_t i = 0; i < n; i++) {
+        int32_t tri = (int32_t)(i % 2048);
+        int32_t v;
+
+        lcg = lcg * 1664525u + 1013904223u;
+        tri = tri < 1024 ? tri : 2047 - tri;
+        v = tri / 2 + 256 + (int32_t)((lcg >> 24) % 33) - 16;
+        if ((lcg & 0x3ff) == 0) {
+            v = (lcg >> 10) % (ADC_MAX_RAW + 1);
+        }
+        buf[i] = (uint16_t)(v < 0 ? 0 : v > ADC_MAX_RAW ? ADC_MAX_RAW : v);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static const struct bench_kernel raw_to_mv[] = {
+        { "raw_to_mv", run_raw_to_mv },
+        { "raw_to_mv_mulshift", run_raw_to_mv_mulshift },
+        { "raw_to_mv_float", run_raw_to_mv_float },
+    };
+    static const struct bench_kernel mv_to_duty[] = {
+        { "mv_to_duty", run_mv_to_duty },
+        { "mv_to_duty_mulshift", run_mv_to_duty_mulshift },
+    };
+    static const struct bench_kernel filt[] = {
+        { "filter_ref", run_filter_ref },
+        { "filter", run_filter },
+    };
+    static const struct bench_kernel filt_resize[] = {
+        { "filter_reinit", run_filter_reinit },
+        { "filter_set_window", run_filter_resize },
+    };
+    static const struct bench_kernel cic[] = {
+        { "cic_ref", run_cic_ref },
+        { "cic", run_cic },
+    };
+    static const struct bench_kernel wave[] = {
+        { "copy", run_copy },
+        { "wavecomp", run_wavecomp },
+    };
+    static const unsigned int windows[] = { 1, 10, FILTER_WINDOW_MAX };
+    static const unsigned int resizes[][2] = { { 10, 4 }, { 4, 10 }, { 1, FILTER_WINDOW_MAX } };
+    static const unsigned int cic_cfgs[][2] = { { 4, 2 }, { 16, 3 }, { 64, 3 }, { 32, 4 } };
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 0) : BENCH_DEFAULT_SAMPLES;
+    uint16_t *raw, *mv, *all;
+    char group[32];
+    int failed = 0;
+
+    raw = malloc(n * sizeof(*raw));
+    mv = malloc(n * sizeof(*mv));
+    all = malloc(65536 * sizeof(*all));
+    /* Worst case WAVE_VARINT_MAX bytes per sample */
+    wave_n_chunks = n / ((WAVE_CHUNK_BYTES - WAVE_VARINT_MAX) / WAVE_VARINT_MAX + 1) + 2;
+    wave_chunks = malloc(wave_n_chunks * sizeof(*wave_chunks));
+    if (!raw || !mv || !all || !wave_chunks || n == 0) {
+        fprintf(stderr, "cannot allocate %zu samples\n", n);
+        return 2;
+    }
+
+    make_input_raw(raw, n);
+    run_raw_to_mv(raw, mv, n, 0);
+    for (size_t i = 0; i < 65536; i++) {
+        all[i] = (uint16_t)i;
+    }
+
+    printf("%zu samples, best of %d runs\n", n, BENCH_REPEAT);
+
+    failed |= bench_group("raw_to_mv", raw_to_mv, 3, raw, n, 0);
+    /* Exhaustive check over the whole input domain */
+    failed |= bench_group("raw_to_mv/all", raw_to_mv, 3, all, ADC_MAX_RAW + 1, 0);
+
+    failed |= bench_group("mv_to_duty", mv_to_duty, 2, mv, n, 0);
+    failed |= bench_group("mv_to_duty/all", mv_to_duty, 2, all, 65536, 0);
+
+    for (size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++) {
+        snprintf(group, sizeof(group), "filter/w%u", windows[w]);
+        failed |= bench_group(group, filt, 2, mv, n, windows[w]);
+    }
+
+    for (size_t r = 0; r < sizeof(resizes) / sizeof(resizes[0]); r++) {
+        snprintf(group, sizeof(group), "filter/w%u-w%u", resizes[r][0], resizes[r][1]);
+        failed |= bench_group(group, filt_resize, 2, mv, n, resizes[r][0] | resizes[r][1] << 8);
+    }
+
+    /* Runs on raw samples, as in the ADC completion callback */
+    for (size_t i = 0; i < sizeof(cic_cfgs) / sizeof(cic_cfgs[0]); i++) {
+        snprintf(group, sizeof(group), "cic/r%un%u", cic_cfgs[i][0], cic_cfgs[i][1]);
+        failed |= bench_group(group, cic, 2, raw, n, cic_cfgs[i][0] | cic_cfgs[i][1] << 8);
+    }
+
+    failed |= bench_group("wave/raw", wave, 2, raw, n, 0);
+    printf("%-14s %.3f bytes/sample with chunk headers\n", "wave/raw", (double)wave_bytes / n);
+    failed |= bench_group("wave/mv", wave, 2, mv, n, 0);
+    printf("%-14s %.3f bytes/sample with chunk headers\n", "wave/mv", (double)wave_bytes / n);
+
+    failed |= check_stats("stats/raw", raw, n);
+    failed |= check_stats("stats/mv", mv, n);
+
+    free(raw);
+    free(mv);
+    free(all);
+    free(wave_chunks);
+
+    printf("%s\n", failed ? "FAILED: see MISMATCH above" : "all checks passed");
+    return failed;
+}
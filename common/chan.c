@@ -0,0 +1,167 @@
+/*
+ * Publish/subscribe channel for pipeline values
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <shell/shell.h>
+
+#include "chan.h"
+
+K_MEM_SLAB_DEFINE(chan_buf_slab, sizeof(struct chan_buf), CONFIG_APP_CHAN_BUFFERS, 4);
+
+CHAN_DEFINE(chan_filtered);
+
+static struct chan *const all_chan[] = {
+    &chan_filtered,
+};
+
+int chan_listen(struct chan *ch, chan_listener_fn fn, void *user_data)
+{
+    k_spinlock_key_t key = k_spin_lock(&ch->lock);
+    int err = -ENOMEM;
+
+    if (ch->n_listeners + ch->n_subs < CHAN_OBSERVERS_MAX) {
+        ch->listeners[ch->n_listeners].fn = fn;
+        ch->listeners[ch->n_listeners].user_data = user_data;
+        ch->n_listeners++;
+        err = 0;
+    }
+    k_spin_unlock(&ch->lock, key);
+    return err;
+}
+
+int chan_subscribe(struct chan *ch, struct k_msgq *q)
+{
+    k_spinlock_key_t key = k_spin_lock(&ch->lock);
+    int err = -ENOMEM;
+
+    if (ch->n_listeners + ch->n_subs < CHAN_OBSERVERS_MAX) {
+        ch->subs[ch->n_subs++] = q;
+        err = 0;
+    }
+    k_spin_unlock(&ch->lock, key);
+    return err;
+}
+
+void chan_publish(struct chan *ch, const struct handoff_msg *msg)
+{
+    struct chan_buf *buf;
+    k_spinlock_key_t key;
+
+    key = k_spin_lock(&ch->lock);
+    ch->latest = *msg;
+    ch->n_pub++;
+    k_spin_unlock(&ch->lock, key);
+
+    for (int i = 0; i < ch->n_listeners; i++) {
+        ch->listeners[i].fn(ch, msg, ch->listeners[i].user_data);
+    }
+
+    if (ch->n_subs == 0) {
+        return;
+    }
+
+    if (k_mem_slab_alloc(&chan_buf_slab, (void **)&buf, K_NO_WAIT)) {
+        ch->n_no_buf++;
+        return;
+    }
+    buf->msg = *msg;
+
+    /* The publisher holds a reference until every queue has been tried */
+    atomic_set(&buf->ref, 1);
+    for (int i = 0; i < ch->n_subs; i++) {
+        atomic_inc(&buf->ref);
+        if (k_msgq_put(ch->subs[i], &buf, K_NO_WAIT)) {
+            atomic_dec(&buf->ref);
+            ch->n_dropped++;
+        }
+    }
+    chan_buf_put(buf);
+}
+
+int chan_read(struct chan *ch, struct handoff_msg *msg)
+{
+    k_spinlock_key_t key = k_spin_lock(&ch->lock);
+    int err = ch->n_pub ? 0 : -ENODATA;
+
+    *msg = ch->latest;
+    k_spin_unlock(&ch->lock, key);
+    return err;
+}
+
+struct chan_buf *chan_buf_get(struct k_msgq *q, k_timeout_t timeout)
+{
+    struct chan_buf *buf;
+
+    if (k_msgq_get(q, &buf, timeout)) {
+        return NULL;
+    }
+    return buf;
+}
+
+void chan_buf_put(struct chan_buf *buf)
+{
+    /* atomic_dec() returns the previous value */
+    if (atomic_dec(&buf->ref) == 1) {
+        k_mem_slab_free(&chan_buf_slab, (void **)&buf);
+    }
+}
+
+#ifdef CONFIG_APP_CHAN_LOG
+CHAN_SUB_DEFINE(chan_log_q, 4);
+
+/* Example subscriber: logs every CONFIG_APP_CHAN_LOG_EVERY-th filtered value */
+static void chan_log_thread(void *p1, void *p2, void *p3)
+{
+    uint32_t n = 0;
+
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    if (chan_subscribe(&chan_filtered, &chan_log_q)) {
+        printk("chan: no room for the log subscriber\n\r");
+        return;
+    }
+
+    while (1) {
+        struct chan_buf *buf = chan_buf_get(&chan_log_q, K_FOREVER);
+
+        if (++n % CONFIG_APP_CHAN_LOG_EVERY == 0) {
+            printk("chan_filtered: seq %u, %u mV\n\r", buf->msg.seq, buf->msg.data);
+        }
+        chan_buf_put(buf);
+    }
+}
+
+K_THREAD_DEFINE(chan_log_tid, 768, chan_log_thread, NULL, NULL, NULL,
+                K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+#endif /* CONFIG_APP_CHAN_LOG */
+
+#ifdef CONFIG_SHELL
+static int cmd_chan(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    for (int i = 0; i < ARRAY_SIZE(all_chan); i++) {
+        struct chan *ch = all_chan[i];
+        struct handoff_msg msg;
+
+        if (chan_read(ch, &msg)) {
+            shell_print(sh, "%s: nothing published", ch->name);
+            continue;
+        }
+        shell_print(sh, "%s: latest seq %u = %u, published %u, %u listeners, %u subscribers",
+            ch->name, msg.seq, msg.data, ch->n_pub, ch->n_listeners, ch->n_subs);
+        shell_print(sh, "  dropped %u (queue full), %u (no buffer)", ch->n_dropped,
+            ch->n_no_buf);
+    }
+    shell_print(sh, "buffers in use %u of %u", k_mem_slab_num_used_get(&chan_buf_slab),
+        CONFIG_APP_CHAN_BUFFERS);
+    return 0;
+}
+
+SHELL_CMD_REGISTER(chan, NULL, "Publish/subscribe channels", cmd_chan);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,83 @@
+/*
+ * Publish/subscribe channel for pipeline values
+ *
+ * A channel holds the latest published message and fans each new one out
+ * to its observers:
+ *  - listeners: called inline, in the publisher's context, with a pointer
+ *    to the message; they must be short and must not block
+ *  - subscribers: a k_msgq of struct chan_buf pointers. All subscribers
+ *    of one publish share a single reference-counted buffer from a fixed
+ *    pool; each one releases it with chan_buf_put() when done.
+ * Any thread can also copy the latest message with chan_read().
+ *
+ * Publishing never blocks: buffers come from the pool and queue puts use
+ * K_NO_WAIT, so its cost is bounded by CONFIG_APP_CHAN_OBSERVERS_MAX.
+ * A full subscriber queue or an empty pool drops that delivery and counts
+ * it. Observers register before the first publish. "chan" in the shell
+ * shows the channels.
+ */
+
+#ifndef CHAN_H
+#define CHAN_H
+
+#include <zephyr.h>
+
+#include "handoff.h"
+
+#define CHAN_OBSERVERS_MAX CONFIG_APP_CHAN_OBSERVERS_MAX
+
+struct chan;
+
+typedef void (*chan_listener_fn)(const struct chan *ch, const struct handoff_msg *msg,
+                                 void *user_data);
+
+/* Buffer shared by the subscribers of one publish */
+struct chan_buf {
+    atomic_t ref;
+    struct handoff_msg msg;
+};
+
+struct chan {
+    const char *name;
+    struct k_spinlock lock;
+    struct handoff_msg latest;
+    uint32_t n_pub;
+    uint32_t n_dropped;         /* subscriber queue full */
+    uint32_t n_no_buf;          /* pool empty, no subscriber served */
+    uint8_t n_listeners;
+    uint8_t n_subs;
+    struct {
+        chan_listener_fn fn;
+        void *user_data;
+    } listeners[CHAN_OBSERVERS_MAX];
+    struct k_msgq *subs[CHAN_OBSERVERS_MAX];
+};
+
+#define CHAN_DEFINE(_name) struct chan _name = { .name = #_name }
+
+/* Queue for a subscriber: '_depth' buffer pointers */
+#define CHAN_SUB_DEFINE(_name, _depth) \
+    K_MSGQ_DEFINE(_name, sizeof(struct chan_buf *), _depth, 4)
+
+/* Filtered values, published by thread_FILTRO_code */
+extern struct chan chan_filtered;
+
+/* Adds a listener; -ENOMEM when the channel is full */
+int chan_listen(struct chan *ch, chan_listener_fn fn, void *user_data);
+
+/* Adds a subscriber queue; -ENOMEM when the channel is full */
+int chan_subscribe(struct chan *ch, struct k_msgq *q);
+
+/* Stores msg as the latest value and delivers it to all observers */
+void chan_publish(struct chan *ch, const struct handoff_msg *msg);
+
+/* Copies the latest value; -ENODATA if nothing was published yet */
+int chan_read(struct chan *ch, struct handoff_msg *msg);
+
+/* Next buffer for a subscriber, NULL on timeout */
+struct chan_buf *chan_buf_get(struct k_msgq *q, k_timeout_t timeout);
+
+/* Drops a subscriber's reference to a buffer */
+void chan_buf_put(struct chan_buf *buf);
+
+#endif /* CHAN_H */
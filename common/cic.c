@@ -0,0 +1,106 @@
+/*
+ * CIC decimator
+ */
+
+#include <errno.h>
+
+#include "cic.h"
+
+/* Largest input (12-bit ADC) times the gain must fit in 32 bits */
+#define CIC_GAIN_MAX (1u << 20)
+
+static uint32_t cic_gain(unsigned int ratio, unsigned int stages)
+{
+    uint32_t gain = 1;
+
+    while (stages--) {
+        gain *= ratio;
+    }
+    return gain;
+}
+
+int cic_init(struct cic *c, unsigned int ratio, unsigned int stages)
+{
+    if (ratio < 1 || ratio > CIC_RATIO_MAX || stages < 1 || stages > CIC_STAGES_MAX ||
+        cic_gain(ratio, stages) > CIC_GAIN_MAX) {
+        return -EINVAL;
+    }
+
+    for (unsigned int s = 0; s < CIC_STAGES_MAX; s++) {
+        c->integ[s] = 0;
+        c->delay[s] = 0;
+    }
+    c->gain = cic_gain(ratio, stages);
+    c->ratio = (uint16_t)ratio;
+    c->stages = (uint16_t)stages;
+    c->phase = 0;
+    return 0;
+}
+
+size_t cic_process(struct cic *c, const uint16_t *in, size_t n, uint16_t *out)
+{
+    size_t n_out = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t acc = in[i];
+
+        for (unsigned int s = 0; s < c->stages; s++) {
+            c->integ[s] += acc;
+            acc = c->integ[s];
+        }
+
+        if (++c->phase < c->ratio) {
+            continue;
+        }
+        c->phase = 0;
+
+        for (unsigned int s = 0; s < c->stages; s++) {
+            uint32_t prev = c->delay[s];
+
+            c->delay[s] = acc;
+            acc -= prev;
+        }
+        out[n_out++] = (uint16_t)((acc + c->gain / 2) / c->gain);
+    }
+
+    return n_out;
+}
+
+size_t cic_decimate_ref(const uint16_t *in, size_t n, unsigned int ratio,
+                        unsigned int stages, uint16_t *out)
+{
+    uint32_t h[CIC_STAGES_MAX * (CIC_RATIO_MAX - 1) + 1];
+    uint32_t gain = cic_gain(ratio, stages);
+    size_t len = 1;
+    size_t n_out = 0;
+
+    /* Impulse response: the length-'ratio' boxcar convolved 'stages' times */
+    h[0] = 1;
+    for (unsigned int s = 0; s < stages; s++) {
+        size_t new_len = len + ratio - 1;
+
+        for (size_t k = new_len; k-- > 0;) {
+            uint32_t sum = 0;
+
+            for (size_t j = 0; j < ratio; j++) {
+                if (k >= j && k - j < len) {
+                    sum += h[k - j];
+                }
+            }
+            h[k] = sum;
+        }
+        len = new_len;
+    }
+
+    /* Outputs at the last input of each group of 'ratio' */
+    for (size_t m = ratio - 1; m < n; m += ratio) {
+        uint32_t acc = 0;
+
+        for (size_t k = 0; k < len && k <= m; k++) {
+            acc += h[k] * in[m - k];
+        }
+        out[n_out++] = (uint16_t)((acc + gain / 2) / gain);
+    }
+
+    return n_out;
+}
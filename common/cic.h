@@ -0,0 +1,45 @@
+/*
+ * CIC decimator
+ *
+ * 'stages' integrators at the input rate, then 'stages' combs (differential
+ * delay 1) at the output rate, one output per 'ratio' inputs. The output
+ * is the DC gain ratio^stages divided out (rounded), so it stays in input
+ * units. Integrators and combs wrap modulo 2^32, which gives the exact
+ * result as long as 4096 * ratio^stages fits in 32 bits (checked by
+ * cic_init()). Plain C, so it also builds on the host.
+ *
+ * cic_decimate_ref() computes the same outputs as a direct FIR with the
+ * boxcar^stages coefficients (checked by bench/).
+ */
+
+#ifndef CIC_H
+#define CIC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CIC_STAGES_MAX 4
+#define CIC_RATIO_MAX 64
+
+struct cic {
+    uint32_t integ[CIC_STAGES_MAX];     /* integrator outputs */
+    uint32_t delay[CIC_STAGES_MAX];     /* previous comb inputs */
+    uint32_t gain;                      /* ratio^stages */
+    uint16_t ratio;
+    uint16_t stages;
+    uint16_t phase;                     /* inputs since the last output */
+};
+
+/* Initializes an empty decimator; returns -EINVAL if the gain overflows */
+int cic_init(struct cic *c, unsigned int ratio, unsigned int stages);
+
+/* Feeds n inputs, writes one output per 'ratio' of them to out;
+ * returns the number of outputs written */
+size_t cic_process(struct cic *c, const uint16_t *in, size_t n, uint16_t *out);
+
+/* Reference: decimates a whole stream from an empty state, returns the
+ * number of outputs (n / ratio) */
+size_t cic_decimate_ref(const uint16_t *in, size_t n, unsigned int ratio,
+                        unsigned int stages, uint16_t *out);
+
+#endif /* CIC_H */
@@ -0,0 +1,75 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Sources shared by the Fifo and Semaphores applications. Included from
+# each application's CMakeLists.txt after find_package(Zephyr); the
+# applications also add this directory to DTS_ROOT for the bindings in
+# dts/bindings.
+
+set(APP_COMMON_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+target_include_directories(app PRIVATE ${APP_COMMON_DIR})
+
+target_sources(app PRIVATE
+  ${APP_COMMON_DIR}/chan.c
+  ${APP_COMMON_DIR}/filter.c
+  ${APP_COMMON_DIR}/handoff.c
+  ${APP_COMMON_DIR}/pipeline_cfg.c
+  ${APP_COMMON_DIR}/pipeline_steps.c
+  ${APP_COMMON_DIR}/seq_check.c
+  ${APP_COMMON_DIR}/stats.c)
+
+target_sources_ifdef(CONFIG_APP_THREAD_STATS app PRIVATE
+  ${APP_COMMON_DIR}/thread_stats.c)
+
+target_sources_ifdef(CONFIG_APP_LATENCY_HIST app PRIVATE
+  ${APP_COMMON_DIR}/histogram.c
+  ${APP_COMMON_DIR}/latency_hist.c)
+
+target_sources_ifdef(CONFIG_APP_PIPELINE_STATS app PRIVATE ${APP_COMMON_DIR}/pipeline_stats.c)
+target_sources_ifdef(CONFIG_APP_FLIGHT_REC app PRIVATE ${APP_COMMON_DIR}/flight_rec.c)
+target_sources_ifdef(CONFIG_APP_WAVE_HIST app PRIVATE
+  ${APP_COMMON_DIR}/wave_hist.c
+  ${APP_COMMON_DIR}/wavecomp.c)
+target_sources_ifdef(CONFIG_APP_SCHED_PROFILE app PRIVATE ${APP_COMMON_DIR}/sched_profile.c)
+target_sources_ifdef(CONFIG_APP_SAMPLE_TS_HW app PRIVATE ${APP_COMMON_DIR}/sample_ts.c)
+target_sources_ifdef(CONFIG_APP_ADC_LIMIT app PRIVATE ${APP_COMMON_DIR}/adc_limit.c)
+target_sources_ifdef(CONFIG_APP_PPI_BYPASS app PRIVATE ${APP_COMMON_DIR}/ppi_bypass.c)
+target_sources_ifdef(CONFIG_APP_ADAPTIVE_RATE app PRIVATE ${APP_COMMON_DIR}/adaptive_rate.c)
+target_sources_ifdef(CONFIG_APP_ADC_DECIM app PRIVATE
+  ${APP_COMMON_DIR}/adc_decim.c
+  ${APP_COMMON_DIR}/cic.c)
+target_sources_ifdef(CONFIG_APP_FANIN app PRIVATE ${APP_COMMON_DIR}/fanin.c)
+target_sources_ifdef(CONFIG_APP_PIPE_POOL app PRIVATE ${APP_COMMON_DIR}/pipe_pool.c)
+target_sources_ifdef(CONFIG_APP_SPECTRUM app PRIVATE ${APP_COMMON_DIR}/spectrum.c)
+target_sources_ifdef(CONFIG_APP_PWM_STUB app PRIVATE ${APP_COMMON_DIR}/pwm_stub.c)
+target_sources_ifdef(CONFIG_APP_PIPE_SENSOR app PRIVATE ${APP_COMMON_DIR}/pipe_sensor.c)
+target_sources_ifdef(CONFIG_APP_ADC_WAVEFORM app PRIVATE ${APP_COMMON_DIR}/adc_waveform.c)
+target_sources_ifdef(CONFIG_APP_REPLAY app PRIVATE ${APP_COMMON_DIR}/replay.c)
+target_sources_ifdef(CONFIG_APP_STRESS app PRIVATE ${APP_COMMON_DIR}/stress.c)
+
+if(CONFIG_APP_CYCLIC)
+  # Schedule table generated from the description in CONFIG_APP_CYCLIC_SCHEDULE
+  get_filename_component(CYCLIC_SCHEDULE ${CONFIG_APP_CYCLIC_SCHEDULE}
+    ABSOLUTE BASE_DIR ${APP_COMMON_DIR})
+  set(CYCLIC_GEN_DIR ${CMAKE_BINARY_DIR}/app_generated)
+  file(MAKE_DIRECTORY ${CYCLIC_GEN_DIR})
+  add_custom_command(
+    OUTPUT ${CYCLIC_GEN_DIR}/cyclic_schedule.h
+    COMMAND ${PYTHON_EXECUTABLE} ${APP_COMMON_DIR}/scripts/gen_schedule.py
+      ${CYCLIC_SCHEDULE} ${CYCLIC_GEN_DIR}/cyclic_schedule.h
+    DEPENDS ${CYCLIC_SCHEDULE} ${APP_COMMON_DIR}/scripts/gen_schedule.py)
+  target_sources(app PRIVATE
+    ${APP_COMMON_DIR}/cyclic.c
+    ${CYCLIC_GEN_DIR}/cyclic_schedule.h)
+  target_include_directories(app PRIVATE ${CYCLIC_GEN_DIR})
+endif()
+
+if(CONFIG_APP_TRACE_MARKERS)
+  target_sources(app PRIVATE ${APP_COMMON_DIR}/trace_markers.c)
+  target_include_directories(app PRIVATE ${ZEPHYR_BASE}/subsys/tracing/ctf)
+
+  # Kernel CTF metadata extended with the application events
+  file(READ ${ZEPHYR_BASE}/subsys/tracing/ctf/tsdl/metadata CTF_KERNEL_METADATA)
+  file(READ ${APP_COMMON_DIR}/tracing/app_events.tsdl CTF_APP_METADATA)
+  file(WRITE ${CMAKE_BINARY_DIR}/ctf/metadata "${CTF_KERNEL_METADATA}${CTF_APP_METADATA}")
+endif()
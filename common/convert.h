@@ -0,0 +1,47 @@
+/*
+ * Sample conversions
+ *
+ * ADC raw value -> mV and mV -> PWM duty cycle (%). The ADC uses gain 1/4
+ * and reference VDD/4 with 10-bit resolution, so 0...1023 maps to 0...3 V.
+ * The plain integer formulas are used by the pipeline; the _mulshift and
+ * _float variants are alternatives kept for bench/, which checks that they
+ * match bit for bit over the whole input range. Plain C.
+ */
+
+#ifndef CONVERT_H
+#define CONVERT_H
+
+#include <stdint.h>
+
+#define ADC_MAX_RAW 1023
+#define ADC_FULL_SCALE_MV 3000
+
+static inline uint16_t convert_raw_to_mv(uint16_t raw)
+{
+    return (uint16_t)((uint32_t)raw * ADC_FULL_SCALE_MV / ADC_MAX_RAW);
+}
+
+/* raw * 3000 / 1023 as a reciprocal multiply, exact for raw <= ADC_MAX_RAW */
+static inline uint16_t convert_raw_to_mv_mulshift(uint16_t raw)
+{
+    return (uint16_t)(((uint64_t)raw * 12595215000ULL) >> 32);
+}
+
+/* Original single-precision expression */
+static inline uint16_t convert_raw_to_mv_float(uint16_t raw)
+{
+    return (uint16_t)(1000 * raw * ((float)3 / 1023));
+}
+
+static inline uint16_t convert_mv_to_duty(uint16_t mv)
+{
+    return (uint16_t)((uint32_t)mv * 100 / ADC_FULL_SCALE_MV);
+}
+
+/* mv * 100 / 3000 as a reciprocal multiply, exact for any 16-bit mv */
+static inline uint16_t convert_mv_to_duty_mulshift(uint16_t mv)
+{
+    return (uint16_t)(((uint32_t)mv * 34953U) >> 20);
+}
+
+#endif /* CONVERT_H */
@@ -0,0 +1,263 @@
+/*
+ * Time-triggered cyclic executive (see cyclic.h)
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <shell/shell.h>
+#include <timing/timing.h>
+#include <string.h>
+#ifdef CONFIG_APP_CYCLIC_COUNTER
+#include <drivers/counter.h>
+#endif
+
+#include "cyclic.h"
+#include "latency_hist.h"
+#include "cyclic_schedule.h"
+
+BUILD_ASSERT(CYCLIC_MINOR_US >= 100, "minor frame below 100 us");
+BUILD_ASSERT(CYCLIC_ADC_PERIOD_US % 1000 == 0,
+             "ADC step period not a whole number of ms (pipeline_cfg adc_period_ms)");
+
+static K_THREAD_STACK_DEFINE(cyclic_stack, CONFIG_APP_CYCLIC_STACK_SIZE);
+static struct k_thread cyclic_thread;
+static K_SEM_DEFINE(tick_sem, 0, 1);
+
+static const cyclic_step_fn *cyclic_steps;
+
+/* Written by the tick interrupt */
+static volatile uint32_t tick_cyc;
+static volatile uint32_t n_ticks;
+static volatile bool busy;
+static uint32_t n_overruns;
+
+/* Written by the executive thread */
+static uint32_t frame_cyc;
+static uint32_t last_tick;
+static uint32_t n_frames;
+static uint32_t n_skipped;
+static uint32_t wake_worst_us;
+static uint32_t frame_worst_us;
+static uint64_t busy_us_sum;
+static uint32_t step_worst_us[CYCLIC_STEP_COUNT];
+static uint32_t step_over[CYCLIC_STEP_COUNT];
+
+static const char *const step_names[CYCLIC_STEP_COUNT] = {
+    [CYCLIC_STEP_ADC] = "adc",
+    [CYCLIC_STEP_FILTER] = "filter",
+    [CYCLIC_STEP_PWM] = "pwm",
+};
+
+static void cyclic_tick(void)
+{
+    tick_cyc = k_cycle_get_32();
+    n_ticks++;
+    if (busy) {
+        n_overruns++;
+    }
+    k_sem_give(&tick_sem);
+}
+
+#ifdef CONFIG_APP_CYCLIC_COUNTER
+static void tick_top(const struct device *dev, void *user_data)
+{
+    ARG_UNUSED(dev);
+    ARG_UNUSED(user_data);
+    cyclic_tick();
+}
+
+static int tick_start(void)
+{
+    const struct device *dev = DEVICE_DT_GET(DT_NODELABEL(timer3));
+    struct counter_top_cfg top = {
+        .ticks = counter_us_to_ticks(dev, CYCLIC_MINOR_US),
+        .callback = tick_top,
+    };
+    int err;
+
+    if (!device_is_ready(dev)) {
+        printk("cyclic: timer3 not ready\n\r");
+        return -ENODEV;
+    }
+    err = counter_set_top_value(dev, &top);
+    if (err == 0) {
+        err = counter_start(dev);
+    }
+    return err;
+}
+#else
+static void tick_expiry(struct k_timer *timer)
+{
+    ARG_UNUSED(timer);
+    cyclic_tick();
+}
+
+static K_TIMER_DEFINE(tick_timer, tick_expiry, NULL);
+
+static int tick_start(void)
+{
+    k_timer_start(&tick_timer, K_USEC(CYCLIC_MINOR_US), K_USEC(CYCLIC_MINOR_US));
+    return 0;
+}
+#endif /* CONFIG_APP_CYCLIC_COUNTER */
+
+static uint32_t cyc_to_us(uint32_t from, uint32_t to)
+{
+    return k_cyc_to_us_floor32(to - from);
+}
+
+/* Steps are timed with the CPU cycle counter: the system clock (30.5 us
+ * on nRF52) is too coarse against their budgets */
+static void run_frame(uint32_t frame)
+{
+    for (int s = 0; s < CYCLIC_N_SLOTS; s++) {
+        uint8_t step = cyclic_table[frame][s];
+        timing_t start, end;
+        uint32_t us;
+
+        if (step == CYCLIC_SLOT_NONE) {
+            break;
+        }
+        start = timing_counter_get();
+        cyclic_steps[step]();
+        end = timing_counter_get();
+        us = (uint32_t)(timing_cycles_to_ns(timing_cycles_get(&start, &end)) / 1000);
+        step_worst_us[step] = MAX(step_worst_us[step], us);
+        if (us > cyclic_budget_us[step]) {
+            step_over[step]++;
+        }
+    }
+}
+
+static void cyclic_thread_code(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    while (1) {
+        uint32_t tick;
+        uint32_t wake_us;
+        uint32_t busy_us;
+
+        k_sem_take(&tick_sem, K_FOREVER);
+        busy = true;
+        tick = n_ticks;
+        frame_cyc = tick_cyc;
+        wake_us = cyc_to_us(frame_cyc, k_cycle_get_32());
+
+        /* Ticks given while the semaphore was full were lost */
+        if (n_frames && tick - last_tick > 1) {
+            n_skipped += tick - last_tick - 1;
+        }
+        last_tick = tick;
+        n_frames++;
+
+        /* The release jitter of the ADC step is the wake-up latency */
+        wake_worst_us = MAX(wake_worst_us, wake_us);
+        if (cyclic_table[tick % CYCLIC_N_FRAMES][0] == CYCLIC_STEP_ADC) {
+            latency_hist_record_us(&hist_adc_jitter, wake_us);
+        }
+
+        run_frame(tick % CYCLIC_N_FRAMES);
+
+        busy_us = cyc_to_us(frame_cyc, k_cycle_get_32());
+        frame_worst_us = MAX(frame_worst_us, busy_us);
+        busy_us_sum += busy_us;
+        busy = false;
+    }
+}
+
+k_tid_t cyclic_start(const cyclic_step_fn steps[CYCLIC_STEP_COUNT])
+{
+    k_tid_t tid;
+    int err;
+
+    cyclic_steps = steps;
+    timing_init();
+    timing_start();
+    tid = k_thread_create(&cyclic_thread, cyclic_stack, K_THREAD_STACK_SIZEOF(cyclic_stack),
+        cyclic_thread_code, NULL, NULL, NULL, CONFIG_APP_CYCLIC_PRIO, 0, K_NO_WAIT);
+    k_thread_name_set(tid, "cyclic");
+
+    err = tick_start();
+    if (err) {
+        printk("cyclic: frame timer failed (%d)\n\r", err);
+        k_thread_abort(tid);
+        return NULL;
+    }
+    printk("cyclic: %d frames of %d us\n\r", CYCLIC_N_FRAMES, CYCLIC_MINOR_US);
+    return tid;
+}
+
+uint32_t cyclic_frame_start(void)
+{
+    return frame_cyc;
+}
+
+uint32_t cyclic_adc_period_ms(void)
+{
+    return CYCLIC_ADC_PERIOD_US / 1000;
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_cyclic_show(const struct shell *sh, size_t argc, char **argv)
+{
+    uint32_t frames = n_frames;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    shell_print(sh, "%d x %d us frames, %u run, %u overruns, %u skipped", CYCLIC_N_FRAMES,
+        CYCLIC_MINOR_US, frames, n_overruns, n_skipped);
+    shell_print(sh, "wake-up worst %u us, frame worst %u us, load %u.%u%%", wake_worst_us,
+        frame_worst_us, frames ? (uint32_t)(busy_us_sum * 100 / frames / CYCLIC_MINOR_US) : 0,
+        frames ? (uint32_t)(busy_us_sum * 1000 / frames / CYCLIC_MINOR_US % 10) : 0);
+    for (int i = 0; i < CYCLIC_STEP_COUNT; i++) {
+        shell_print(sh, "  %-6s worst %5u us, budget %5u us, %u over", step_names[i],
+            step_worst_us[i], cyclic_budget_us[i], step_over[i]);
+    }
+    return 0;
+}
+
+static int cmd_cyclic_table(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    for (int f = 0; f < CYCLIC_N_FRAMES; f++) {
+        shell_fprintf(sh, SHELL_NORMAL, "  frame %3d:", f);
+        for (int s = 0; s < CYCLIC_N_SLOTS && cyclic_table[f][s] != CYCLIC_SLOT_NONE; s++) {
+            shell_fprintf(sh, SHELL_NORMAL, " %s", step_names[cyclic_table[f][s]]);
+        }
+        shell_fprintf(sh, SHELL_NORMAL, "\n");
+    }
+    return 0;
+}
+
+static int cmd_cyclic_reset(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(sh);
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    n_overruns = 0;
+    n_frames = 0;
+    n_skipped = 0;
+    wake_worst_us = 0;
+    frame_worst_us = 0;
+    busy_us_sum = 0;
+    memset(step_worst_us, 0, sizeof(step_worst_us));
+    memset(step_over, 0, sizeof(step_over));
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_cyclic,
+    SHELL_CMD(show, NULL, "Overruns, frame load and step times", cmd_cyclic_show),
+    SHELL_CMD(table, NULL, "Steps of each minor frame", cmd_cyclic_table),
+    SHELL_CMD(reset, NULL, "Clear the statistics", cmd_cyclic_reset),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(cyclic, &sub_cyclic, "Cyclic executive", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,55 @@
+/*
+ * Time-triggered cyclic executive
+ *
+ * Replaces the three event-chained pipeline threads with one executive
+ * thread released by a periodic timer interrupt every minor frame. Each
+ * minor frame runs a fixed list of stage steps from a static schedule
+ * table; the table repeats every major frame. The table is generated at
+ * build time by scripts/gen_schedule.py from the file named by
+ * CONFIG_APP_CYCLIC_SCHEDULE (step periods and offsets in minor frames,
+ * plus a time budget per step), which also checks that every frame fits.
+ *
+ * With CONFIG_APP_CYCLIC_COUNTER the frame tick comes from TIMER3 through
+ * the counter API, otherwise from a k_timer. A tick that finds the
+ * previous frame still running is a frame overrun; frames whose tick was
+ * missed are skipped, so the table stays aligned with time. The "cyclic"
+ * shell command shows overruns, skipped frames, wake-up latency, frame
+ * load and the worst time of each step against its budget. ADC release
+ * jitter goes to the same histogram as in the threaded variant
+ * (latency_hist.h), for comparison.
+ */
+
+#ifndef CYCLIC_H
+#define CYCLIC_H
+
+#include <zephyr.h>
+
+enum cyclic_step {
+    CYCLIC_STEP_ADC,
+    CYCLIC_STEP_FILTER,
+    CYCLIC_STEP_PWM,
+    CYCLIC_STEP_COUNT,
+};
+
+typedef void (*cyclic_step_fn)(void);
+
+static inline bool cyclic_enabled(void)
+{
+    return IS_ENABLED(CONFIG_APP_CYCLIC);
+}
+
+#ifdef CONFIG_APP_CYCLIC
+
+/* Starts the frame timer and the executive thread running 'steps';
+ * returns the thread, or NULL if the timer could not be started */
+k_tid_t cyclic_start(const cyclic_step_fn steps[CYCLIC_STEP_COUNT]);
+
+/* Tick instant (k_cycle_get_32) of the frame being executed */
+uint32_t cyclic_frame_start(void);
+
+/* Period of the ADC step in the schedule, 0 if it is not scheduled */
+uint32_t cyclic_adc_period_ms(void);
+
+#endif /* CONFIG_APP_CYCLIC */
+
+#endif /* CYCLIC_H */
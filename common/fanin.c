@@ -0,0 +1,246 @@
+/*
+ * Fan-in of several filtered streams into one actuator update
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <shell/shell.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fanin.h"
+#include "sample_ts.h"
+
+BUILD_ASSERT(FANIN_INPUTS >= 1 && FANIN_INPUTS <= 32, "one pending bit per input");
+
+struct fanin_slot {
+    struct k_spinlock lock;     /* msg, t_put_ms and n_put */
+    struct handoff_msg msg;
+    uint32_t t_put_ms;
+    uint32_t n_put;
+    uint16_t weight;
+};
+
+static struct fanin_slot slots[FANIN_INPUTS];
+static atomic_t pending;        /* inputs updated since the last fanin_get() */
+static atomic_t valid;          /* inputs that ever produced a value */
+static atomic_t n_coalesced;    /* puts that found their bit already set */
+static uint32_t n_updates;
+static enum fanin_rule rule = IS_ENABLED(CONFIG_APP_FANIN_MIN) ? FANIN_MIN :
+                              IS_ENABLED(CONFIG_APP_FANIN_WEIGHTED) ? FANIN_WEIGHTED : FANIN_MAX;
+static K_SEM_DEFINE(fanin_sem, 0, 1);
+
+static const char *const rule_names[] = {
+    [FANIN_MAX] = "max",
+    [FANIN_MIN] = "min",
+    [FANIN_WEIGHTED] = "weighted",
+};
+
+static int fanin_init(const struct device *dev)
+{
+    ARG_UNUSED(dev);
+
+    for (int i = 0; i < FANIN_INPUTS; i++) {
+        slots[i].weight = 1;
+    }
+    return 0;
+}
+
+SYS_INIT(fanin_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+int fanin_put(unsigned int input, const struct handoff_msg *msg)
+{
+    struct fanin_slot *s;
+    k_spinlock_key_t key;
+
+    if (input >= FANIN_INPUTS) {
+        return -EINVAL;
+    }
+    s = &slots[input];
+
+    key = k_spin_lock(&s->lock);
+    s->msg = *msg;
+    s->t_put_ms = k_uptime_get_32();
+    s->n_put++;
+    k_spin_unlock(&s->lock, key);
+
+    atomic_or(&valid, BIT(input));
+    if (atomic_or(&pending, BIT(input)) & BIT(input)) {
+        atomic_inc(&n_coalesced);
+    }
+    k_sem_give(&fanin_sem);
+    return 0;
+}
+
+/* Consistent copy of a slot; returns its put count */
+static uint32_t fanin_read(struct fanin_slot *s, struct handoff_msg *msg, uint32_t *t_put_ms)
+{
+    k_spinlock_key_t key = k_spin_lock(&s->lock);
+    uint32_t n_put = s->n_put;
+
+    *msg = s->msg;
+    *t_put_ms = s->t_put_ms;
+    k_spin_unlock(&s->lock, key);
+
+    return n_put;
+}
+
+void fanin_get(struct handoff_msg *out)
+{
+    while (1) {
+        uint32_t updated, inputs, now = k_uptime_get_32();
+        uint32_t sum = 0, weights = 0, n = 0;
+        bool have_ts = false;
+
+        k_sem_take(&fanin_sem, K_FOREVER);
+        updated = (uint32_t)atomic_clear(&pending);
+        if (!updated) {
+            continue;
+        }
+        inputs = (uint32_t)atomic_get(&valid);
+
+        for (int i = 0; i < FANIN_INPUTS; i++) {
+            struct handoff_msg msg;
+            uint32_t t_put_ms;
+
+            if (!(inputs & BIT(i))) {
+                continue;
+            }
+            fanin_read(&slots[i], &msg, &t_put_ms);
+            if (CONFIG_APP_FANIN_STALE_MS && now - t_put_ms > CONFIG_APP_FANIN_STALE_MS) {
+                continue;
+            }
+
+            /* Timestamps of the oldest triggering sample */
+            if ((updated & BIT(i)) &&
+                (!have_ts || (int32_t)(msg.t_sample - out->t_sample) < 0)) {
+                out->t_release = msg.t_release;
+                out->t_sample = msg.t_sample;
+                have_ts = true;
+            }
+
+            switch (rule) {
+            case FANIN_MAX:
+                sum = n ? MAX(sum, msg.data) : msg.data;
+                break;
+            case FANIN_MIN:
+                sum = n ? MIN(sum, msg.data) : msg.data;
+                break;
+            case FANIN_WEIGHTED:
+                sum += (uint32_t)slots[i].weight * msg.data;
+                weights += slots[i].weight;
+                break;
+            }
+            n++;
+        }
+
+        /* Only stale inputs updated, or all weights are 0 */
+        if (!have_ts || (rule == FANIN_WEIGHTED && weights == 0)) {
+            continue;
+        }
+
+        out->data = (uint16_t)(rule == FANIN_WEIGHTED ? (sum + weights / 2) / weights : sum);
+        out->seq = n_updates++;
+        return;
+    }
+}
+
+void fanin_set_rule(enum fanin_rule new_rule)
+{
+    rule = new_rule;
+}
+
+int fanin_set_weight(unsigned int input, uint16_t weight)
+{
+    if (input >= FANIN_INPUTS) {
+        return -EINVAL;
+    }
+    slots[input].weight = weight;
+    return 0;
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_fanin_show(const struct shell *sh, size_t argc, char **argv)
+{
+    uint32_t inputs = (uint32_t)atomic_get(&valid);
+    uint32_t now = k_uptime_get_32();
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    shell_print(sh, "rule %s, %u combined updates, %u puts coalesced", rule_names[rule],
+        n_updates, (uint32_t)atomic_get(&n_coalesced));
+    for (int i = 0; i < FANIN_INPUTS; i++) {
+        struct handoff_msg msg;
+        uint32_t t_put_ms, n_put;
+
+        if (!(inputs & BIT(i))) {
+            shell_print(sh, "  input %d: no value, weight %u", i, slots[i].weight);
+            continue;
+        }
+        n_put = fanin_read(&slots[i], &msg, &t_put_ms);
+        shell_print(sh, "  input %d: %u mV, %u ms old, %u puts, weight %u", i, msg.data,
+            now - t_put_ms, n_put, slots[i].weight);
+    }
+    return 0;
+}
+
+static int cmd_fanin_rule(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+
+    for (int r = 0; r < ARRAY_SIZE(rule_names); r++) {
+        if (strcmp(argv[1], rule_names[r]) == 0) {
+            fanin_set_rule((enum fanin_rule)r);
+            return 0;
+        }
+    }
+    shell_error(sh, "unknown rule %s (max|min|weighted)", argv[1]);
+    return -EINVAL;
+}
+
+static int cmd_fanin_weight(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+
+    if (fanin_set_weight(strtoul(argv[1], NULL, 0), (uint16_t)strtoul(argv[2], NULL, 0))) {
+        shell_error(sh, "input must be below %d", FANIN_INPUTS);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+/* Acts as the producer of an input no pipeline feeds */
+static int cmd_fanin_set(const struct shell *sh, size_t argc, char **argv)
+{
+    unsigned long input = strtoul(argv[1], NULL, 0);
+    struct handoff_msg msg = {
+        .data = (uint16_t)strtoul(argv[2], NULL, 0),
+        .t_release = k_cycle_get_32(),
+    };
+
+    ARG_UNUSED(argc);
+
+    if (input == FANIN_INPUT_FILTRO) {
+        shell_error(sh, "input %d is fed by FILTRO", FANIN_INPUT_FILTRO);
+        return -EINVAL;
+    }
+    /* Same time base as FILTRO's samples, compared in fanin_get() */
+    msg.t_sample = sample_ts_now();
+    if (fanin_put(input, &msg)) {
+        shell_error(sh, "input must be below %d", FANIN_INPUTS);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_fanin,
+    SHELL_CMD(show, NULL, "Rule and latest value of each input", cmd_fanin_show),
+    SHELL_CMD_ARG(rule, NULL, "Set combining rule: <max|min|weighted>", cmd_fanin_rule, 2, 0),
+    SHELL_CMD_ARG(weight, NULL, "Set weight: <input> <weight>", cmd_fanin_weight, 3, 0),
+    SHELL_CMD_ARG(set, NULL, "Feed a test value: <input, not 0> <mV>", cmd_fanin_set, 3, 0),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(fanin, &sub_fanin, "Fan-in of the filtered streams", NULL);
+#endif /* CONFIG_SHELL */
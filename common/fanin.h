@@ -0,0 +1,51 @@
+/*
+ * Fan-in of several filtered streams into one actuator update
+ *
+ * Each of CONFIG_APP_FANIN_INPUTS inputs has one producer, which stores
+ * its latest message in the input's slot, sets the input's bit in an
+ * atomic pending mask and wakes the single consumer. Slots are copied in
+ * and out under a per-slot spinlock: a few words, so a higher-priority
+ * consumer never waits on a preempted producer. The consumer takes the whole mask at
+ * once and combines the latest value of every fresh input (updated within
+ * CONFIG_APP_FANIN_STALE_MS; 0 keeps values forever) into one message:
+ *  - FANIN_MAX / FANIN_MIN: largest / smallest value
+ *  - FANIN_WEIGHTED: weighted mean (all weights 1 by default)
+ * Updates arriving faster than the consumer are coalesced, so the output
+ * follows once per combined update, never once per input.
+ *
+ * The combined message carries the oldest timestamps among the inputs
+ * that triggered it and its own sequence number. Rule, weights and test
+ * inputs are set with the "fanin" shell command.
+ */
+
+#ifndef FANIN_H
+#define FANIN_H
+
+#include <zephyr.h>
+
+#include "handoff.h"
+
+#define FANIN_INPUTS CONFIG_APP_FANIN_INPUTS
+
+/* Input fed by the application's own FILTRO */
+#define FANIN_INPUT_FILTRO 0
+
+enum fanin_rule {
+    FANIN_MAX,
+    FANIN_MIN,
+    FANIN_WEIGHTED,
+};
+
+/* Stores msg as the latest value of 'input'; one producer per input.
+ * Returns -EINVAL for an unknown input */
+int fanin_put(unsigned int input, const struct handoff_msg *msg);
+
+/* Waits for at least one input update and returns the combined message */
+void fanin_get(struct handoff_msg *out);
+
+void fanin_set_rule(enum fanin_rule rule);
+
+/* Weight of 'input' in FANIN_WEIGHTED (0 excludes it) */
+int fanin_set_weight(unsigned int input, uint16_t weight);
+
+#endif /* FANIN_H */
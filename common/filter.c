@@ -0,0 +1,104 @@
+/*
+ * Moving-average filter with outlier rejection
+ */
+
+#include "filter.h"
+
+void filter_init(struct filter *f, unsigned int window)
+{
+    if (window < 1) {
+        window = 1;
+    } else if (window > FILTER_WINDOW_MAX) {
+        window = FILTER_WINDOW_MAX;
+    }
+
+    f->window = (uint16_t)window;
+    f->count = 0;
+    f->head = 0;
+    stats_window_reset(&f->stats);
+}
+
+void filter_set_window(struct filter *f, unsigned int window)
+{
+    uint16_t keep[FILTER_WINDOW_MAX];
+    unsigned int n = f->count;
+    unsigned int oldest = f->count < f->window ? 0 : f->head;
+    unsigned int i;
+
+    /* Valid samples, oldest first */
+    for (i = 0; i < n; i++) {
+        keep[i] = f->samples[(oldest + i) % f->window];
+    }
+
+    filter_init(f, window);
+
+    /* The most recent ones that fit the new window */
+    for (i = n > f->window ? n - f->window : 0; i < n; i++) {
+        f->samples[f->count++] = keep[i];
+        stats_window_add(&f->stats, keep[i]);
+    }
+    f->head = f->count % f->window;
+}
+
+/* Mean of the samples inside +/- FILTER_BAND_PCT of 'mean' */
+static uint16_t filter_band_mean(const struct filter *f, uint32_t mean)
+{
+    uint32_t band = mean * FILTER_BAND_PCT / 100;
+    uint32_t sum_ok = 0, n_ok = 0;
+
+    for (int i = 0; i < f->count; i++) {
+        if (f->samples[i] + band >= mean && f->samples[i] <= mean + band) {
+            sum_ok += f->samples[i];
+            n_ok++;
+        }
+    }
+
+    return (uint16_t)(n_ok ? sum_ok / n_ok : mean);
+}
+
+uint16_t filter_update(struct filter *f, uint16_t sample)
+{
+    uint32_t mean, band;
+
+    if (f->count < f->window) {
+        f->count++;
+    } else {
+        stats_window_remove(&f->stats, f->samples[f->head]);
+    }
+    stats_window_add(&f->stats, sample);
+    f->samples[f->head] = sample;
+    if (++f->head >= f->window) {
+        f->head = 0;
+    }
+
+    /* Nothing to reject when the whole window lies inside the band */
+    mean = f->stats.sum / f->count;
+    band = mean * FILTER_BAND_PCT / 100;
+    if (stats_window_min(&f->stats) + band >= mean && stats_window_max(&f->stats) <= mean + band) {
+        return (uint16_t)mean;
+    }
+
+    return filter_band_mean(f, mean);
+}
+
+uint16_t filter_update_ref(struct filter *f, uint16_t sample)
+{
+    unsigned int oldest;
+
+    f->samples[f->head] = sample;
+    if (++f->head >= f->window) {
+        f->head = 0;
+    }
+    if (f->count < f->window) {
+        f->count++;
+    }
+
+    /* Rebuilt from the window, oldest first */
+    oldest = f->count < f->window ? 0 : f->head;
+    stats_window_reset(&f->stats);
+    for (int i = 0; i < f->count; i++) {
+        stats_window_add(&f->stats, f->samples[(oldest + i) % f->window]);
+    }
+
+    return filter_band_mean(f, f->stats.sum / f->count);
+}
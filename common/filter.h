@@ -0,0 +1,54 @@
+/*
+ * Moving-average filter with outlier rejection
+ *
+ * Keeps the last 'window' samples. Each update computes the window mean,
+ * discards the samples further than 10% away from it and returns the mean
+ * of the remaining ones (or the plain mean, if none remain).
+ * Integer arithmetic only; plain C, so it also builds on the host.
+ *
+ * filter_update() keeps running window statistics (stats.h) and skips
+ * the rejection scan when the window min/max are inside the band;
+ * filter_update_ref() rescans the window. Both give identical results
+ * (checked by bench/) and keep the same state, so they can be mixed on
+ * one filter.
+ */
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdint.h>
+
+#include "stats.h"
+
+#ifndef FILTER_WINDOW_MAX
+#ifdef CONFIG_APP_FILTER_WINDOW_MAX
+#define FILTER_WINDOW_MAX CONFIG_APP_FILTER_WINDOW_MAX
+#else
+#define FILTER_WINDOW_MAX 32
+#endif
+#endif
+
+/* Accepted band around the mean, in percent of the mean */
+#define FILTER_BAND_PCT 10
+
+struct filter {
+    uint16_t samples[FILTER_WINDOW_MAX];
+    uint16_t window;            /* active window length */
+    uint16_t count;             /* valid samples, up to window */
+    uint16_t head;              /* next write position */
+    struct stats_window stats;  /* statistics of the valid samples */
+};
+
+/* Initializes the filter with an empty history of 'window' samples */
+void filter_init(struct filter *f, unsigned int window);
+
+/* Changes the window length, keeping the most recent samples that fit */
+void filter_set_window(struct filter *f, unsigned int window);
+
+/* Adds one sample and returns the filtered value */
+uint16_t filter_update(struct filter *f, uint16_t sample);
+
+/* Reference implementation of filter_update() */
+uint16_t filter_update_ref(struct filter *f, uint16_t sample);
+
+#endif /* FILTER_H */
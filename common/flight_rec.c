@@ -0,0 +1,173 @@
+/*
+ * Post-mortem flight recorder
+ */
+
+#include <zephyr.h>
+#include <fatal.h>
+#include <sys/printk.h>
+#include <shell/shell.h>
+#include <timing/timing.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flight_rec.h"
+
+#define FLIGHT_REC_MAGIC 0x43455246     /* "FREC" */
+
+/* Events measured by "frec stats" */
+#define FLIGHT_REC_BENCH_N 16
+
+__noinit struct flight_rec flight_rec;
+
+static const char *const event_names[FLIGHT_REC_EVENT_COUNT] = {
+    [FLIGHT_REC_SAMPLE] = "sample",
+    [FLIGHT_REC_FILTER] = "filter",
+    [FLIGHT_REC_PWM] = "pwm",
+    [FLIGHT_REC_ADC_ERROR] = "adcerr",
+    [FLIGHT_REC_FAULT] = "FAULT",
+    [FLIGHT_REC_BOOT] = "boot",
+};
+
+/* Prints the last 'max' events, oldest first, with the time since the previous one */
+static void flight_rec_print(uint32_t max)
+{
+    uint32_t head = (uint32_t)atomic_get(&flight_rec.head);
+    uint32_t n = MIN(MIN(head, (uint32_t)FLIGHT_REC_ENTRIES), max);
+    uint32_t prev_cyc = 0;
+
+    printk("flight recorder: run %u, %u events, last %u:\n\r", flight_rec.boots, head, n);
+    for (uint32_t i = head - n; i != head; i++) {
+        const struct flight_rec_entry *e = &flight_rec.ring[i & (FLIGHT_REC_ENTRIES - 1)];
+        const char *name = e->event < FLIGHT_REC_EVENT_COUNT ? event_names[e->event] : "?";
+
+        /* Stamps restart at a reset */
+        if (i == head - n || e->event == FLIGHT_REC_BOOT) {
+            printk("  %10s #%5u %-6s %5u %6d\n\r", "", e->seq, name, e->val, e->code);
+        } else {
+            printk("  %8u us #%5u %-6s %5u %6d\n\r", k_cyc_to_us_floor32(e->t_cyc - prev_cyc),
+                e->seq, name, e->val, e->code);
+        }
+        prev_cyc = e->t_cyc;
+    }
+}
+
+void flight_rec_dump(void)
+{
+    flight_rec_print(FLIGHT_REC_ENTRIES);
+}
+
+#ifdef CONFIG_APP_FLIGHT_REC_FAULT_DUMP
+void k_sys_fatal_error_handler(unsigned int reason, const z_arch_esf_t *esf)
+{
+    ARG_UNUSED(esf);
+
+    flight_rec_log(FLIGHT_REC_FAULT, 0, 0, (int16_t)reason);
+    flight_rec_dump();
+    k_fatal_halt(reason);
+}
+#endif
+
+static int flight_rec_init(const struct device *dev)
+{
+    ARG_UNUSED(dev);
+
+    if (flight_rec.magic != FLIGHT_REC_MAGIC) {
+        /* Cold boot: RAM content is random */
+        memset(&flight_rec, 0, sizeof(flight_rec));
+        flight_rec.magic = FLIGHT_REC_MAGIC;
+    } else if (IS_ENABLED(CONFIG_APP_FLIGHT_REC_BOOT_DUMP) && atomic_get(&flight_rec.head)) {
+        printk("\n\rEvents before the reset:\n\r");
+        flight_rec_dump();
+    }
+
+    flight_rec.boots++;
+    flight_rec_log(FLIGHT_REC_BOOT, 0, 0, (int16_t)flight_rec.boots);
+    return 0;
+}
+
+SYS_INIT(flight_rec_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#ifdef CONFIG_SHELL
+static int cmd_frec_dump(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(sh);
+
+    flight_rec_print(argc > 1 ? strtoul(argv[1], NULL, 0) : FLIGHT_REC_ENTRIES);
+    return 0;
+}
+
+static int cmd_frec_stats(const struct shell *sh, size_t argc, char **argv)
+{
+    uint32_t counts[FLIGHT_REC_EVENT_COUNT] = { 0 };
+    uint32_t head = (uint32_t)atomic_get(&flight_rec.head);
+    uint32_t n = MIN(head, (uint32_t)FLIGHT_REC_ENTRIES);
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    for (uint32_t i = head - n; i != head; i++) {
+        uint8_t ev = flight_rec.ring[i & (FLIGHT_REC_ENTRIES - 1)].event;
+
+        if (ev < FLIGHT_REC_EVENT_COUNT) {
+            counts[ev]++;
+        }
+    }
+    shell_print(sh, "run %u, %u events, %u entries of %zu B in .noinit", flight_rec.boots, head,
+        FLIGHT_REC_ENTRIES, sizeof(struct flight_rec_entry));
+    for (int i = 0; i < FLIGHT_REC_EVENT_COUNT; i++) {
+        shell_print(sh, "  %-6s %u", event_names[i], counts[i]);
+    }
+
+#ifdef CONFIG_TIMING_FUNCTIONS
+    {
+        struct flight_rec_entry saved[FLIGHT_REC_BENCH_N];
+        uint32_t first = (uint32_t)atomic_get(&flight_rec.head);
+        unsigned int key;
+        timing_t start, end;
+        uint64_t cycles;
+
+        /* Records and then restores the entries it overwrote */
+        key = irq_lock();
+        for (int i = 0; i < FLIGHT_REC_BENCH_N; i++) {
+            saved[i] = flight_rec.ring[(first + i) & (FLIGHT_REC_ENTRIES - 1)];
+        }
+        timing_init();
+        timing_start();
+        start = timing_counter_get();
+        for (int i = 0; i < FLIGHT_REC_BENCH_N; i++) {
+            flight_rec_log(FLIGHT_REC_SAMPLE, i, 0, 0);
+        }
+        end = timing_counter_get();
+        for (int i = 0; i < FLIGHT_REC_BENCH_N; i++) {
+            flight_rec.ring[(first + i) & (FLIGHT_REC_ENTRIES - 1)] = saved[i];
+        }
+        atomic_set(&flight_rec.head, first);
+        irq_unlock(key);
+
+        cycles = timing_cycles_get(&start, &end);
+        shell_print(sh, "flight_rec_log(): %u cycles, %u ns", (uint32_t)(cycles / FLIGHT_REC_BENCH_N),
+            (uint32_t)(timing_cycles_to_ns(cycles) / FLIGHT_REC_BENCH_N));
+    }
+#endif
+    return 0;
+}
+
+static int cmd_frec_clear(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(sh);
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    atomic_set(&flight_rec.head, 0);
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_frec,
+    SHELL_CMD_ARG(dump, NULL, "Print the recorded events: [last n]", cmd_frec_dump, 1, 1),
+    SHELL_CMD(stats, NULL, "Events per type and recording cost", cmd_frec_stats),
+    SHELL_CMD(clear, NULL, "Forget the recorded events", cmd_frec_clear),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(frec, &sub_frec, "Flight recorder", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,88 @@
+/*
+ * Post-mortem flight recorder
+ *
+ * A ring of the last CONFIG_APP_FLIGHT_REC_ENTRIES pipeline events (raw
+ * sample, filter output, duty, errors, each with a k_cycle_get_32 stamp
+ * and the sample sequence number) kept in .noinit RAM, so it survives a
+ * warm reset: after one, recording continues in the same ring after a
+ * FLIGHT_REC_BOOT event, and the events before the reset are printed at
+ * boot. The ring is also printed by "frec dump" and by the fatal error
+ * handler (unless CONFIG_RESET_ON_FATAL_ERROR, in which case the next
+ * boot prints it).
+ *
+ * flight_rec_log() is inline: one atomic increment and four stores, no
+ * lock, callable from any thread or ISR. "frec stats" measures its cost.
+ */
+
+#ifndef FLIGHT_REC_H
+#define FLIGHT_REC_H
+
+#include <zephyr.h>
+
+enum flight_rec_event {
+    FLIGHT_REC_SAMPLE,          /* val: raw ADC value */
+    FLIGHT_REC_FILTER,          /* val: filtered value (mV) */
+    FLIGHT_REC_PWM,             /* val: duty (%), code: pwm_pin_set result */
+    FLIGHT_REC_ADC_ERROR,       /* code: adc_read()/replay error */
+    FLIGHT_REC_FAULT,           /* code: fatal error reason */
+    FLIGHT_REC_BOOT,            /* code: runs recorded into this RAM */
+    FLIGHT_REC_EVENT_COUNT,
+};
+
+struct flight_rec_entry {
+    uint32_t t_cyc;             /* k_cycle_get_32() */
+    uint16_t seq;               /* low bits of the sample sequence number */
+    uint8_t event;              /* enum flight_rec_event */
+    uint8_t reserved;
+    uint16_t val;
+    int16_t code;
+};
+
+#ifdef CONFIG_APP_FLIGHT_REC
+
+#define FLIGHT_REC_ENTRIES CONFIG_APP_FLIGHT_REC_ENTRIES
+
+BUILD_ASSERT((FLIGHT_REC_ENTRIES & (FLIGHT_REC_ENTRIES - 1)) == 0,
+    "CONFIG_APP_FLIGHT_REC_ENTRIES must be a power of two");
+
+struct flight_rec {
+    uint32_t magic;
+    uint32_t boots;             /* runs recorded into this RAM */
+    atomic_t head;              /* events recorded, also the ring write index */
+    struct flight_rec_entry ring[FLIGHT_REC_ENTRIES];
+};
+
+extern struct flight_rec flight_rec;
+
+static inline void flight_rec_log(enum flight_rec_event event, uint32_t seq, uint16_t val,
+                                  int16_t code)
+{
+    struct flight_rec_entry *e =
+        &flight_rec.ring[(uint32_t)atomic_inc(&flight_rec.head) & (FLIGHT_REC_ENTRIES - 1)];
+
+    e->t_cyc = k_cycle_get_32();
+    e->seq = (uint16_t)seq;
+    e->event = (uint8_t)event;
+    e->val = val;
+    e->code = code;
+}
+
+/* Prints the ring, oldest first */
+void flight_rec_dump(void);
+
+#else
+
+static inline void flight_rec_log(enum flight_rec_event event, uint32_t seq, uint16_t val,
+                                  int16_t code)
+{
+    ARG_UNUSED(event);
+    ARG_UNUSED(seq);
+    ARG_UNUSED(val);
+    ARG_UNUSED(code);
+}
+
+static inline void flight_rec_dump(void) {}
+
+#endif /* CONFIG_APP_FLIGHT_REC */
+
+#endif /* FLIGHT_REC_H */
@@ -0,0 +1,300 @@
+/*
+ * Bounded hand-off between pipeline stages with an explicit overload policy
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <shell/shell.h>
+#include <string.h>
+
+#include "handoff.h"
+#include "app_print.h"
+
+/* Hand-offs registered by the init functions, for the shell */
+#define HANDOFF_MAX 4
+
+#if defined(CONFIG_APP_HANDOFF_COALESCE_LATEST)
+#define HANDOFF_DEFAULT_POLICY HANDOFF_COALESCE_LATEST
+#elif defined(CONFIG_APP_HANDOFF_BACKPRESSURE)
+#define HANDOFF_DEFAULT_POLICY HANDOFF_BACKPRESSURE
+#else
+#define HANDOFF_DEFAULT_POLICY HANDOFF_DROP_OLDEST
+#endif
+
+static struct handoff *all_handoffs[HANDOFF_MAX];
+static int n_handoffs;
+
+static const char *const policy_names[] = {
+    [HANDOFF_DROP_OLDEST] = "drop",
+    [HANDOFF_COALESCE_LATEST] = "coalesce",
+    [HANDOFF_BACKPRESSURE] = "block",
+};
+
+const char *handoff_policy_name(enum handoff_policy policy)
+{
+    return policy_names[policy];
+}
+
+static void handoff_register(struct handoff *ho, const char *name)
+{
+    ho->name = name;
+    ho->policy = HANDOFF_DEFAULT_POLICY;
+    seq_check_reset(&ho->seq);
+
+    __ASSERT(n_handoffs < HANDOFF_MAX, "too many hand-offs");
+    if (n_handoffs < HANDOFF_MAX) {
+        all_handoffs[n_handoffs++] = ho;
+    }
+}
+
+/* One message more queued; only the producer updates max_level */
+static void handoff_level_inc(struct handoff *ho)
+{
+    atomic_val_t level = atomic_inc(&ho->level) + 1;
+
+    if (level > atomic_get(&ho->max_level)) {
+        atomic_set(&ho->max_level, level);
+    }
+    atomic_inc(&ho->n_put);
+}
+
+/* k_fifo flavour */
+
+void handoff_fifo_init(struct handoff_fifo *h, const char *name)
+{
+    k_fifo_init(&h->fifo);
+    handoff_register(&h->ho, name);
+}
+
+int handoff_fifo_put(struct handoff_fifo *h, const struct handoff_msg *msg)
+{
+    struct handoff_fifo_item *item;
+    int discarded = 0;
+
+    if (h->ho.policy == HANDOFF_COALESCE_LATEST) {
+        while ((item = k_fifo_get(&h->fifo, K_NO_WAIT)) != NULL) {
+            k_mem_slab_free(h->slab, (void **)&item);
+            atomic_dec(&h->ho.level);
+            atomic_inc(&h->ho.n_coalesced);
+            discarded++;
+        }
+    }
+
+    if (k_mem_slab_alloc(h->slab, (void **)&item, K_NO_WAIT) != 0) {
+        if (h->ho.policy == HANDOFF_DROP_OLDEST &&
+            (item = k_fifo_get(&h->fifo, K_NO_WAIT)) != NULL) {
+            /* The oldest message's block is reused */
+            atomic_dec(&h->ho.level);
+            atomic_inc(&h->ho.n_dropped);
+            discarded++;
+        } else {
+            /* Backpressure, or the consumer is copying the last message out */
+            if (h->ho.policy == HANDOFF_BACKPRESSURE) {
+                atomic_inc(&h->ho.n_blocked);
+            }
+            k_mem_slab_alloc(h->slab, (void **)&item, K_FOREVER);
+        }
+    }
+
+    item->msg = *msg;
+    handoff_level_inc(&h->ho);
+    k_fifo_put(&h->fifo, item);
+
+    return discarded;
+}
+
+void handoff_fifo_get(struct handoff_fifo *h, struct handoff_msg *msg)
+{
+    struct handoff_fifo_item *item = k_fifo_get(&h->fifo, K_FOREVER);
+
+    atomic_dec(&h->ho.level);
+    *msg = item->msg;
+    k_mem_slab_free(h->slab, (void **)&item);
+
+    seq_check_update(&h->ho.seq, msg->seq);
+}
+
+/* Semaphore flavour */
+
+void handoff_sem_init(struct handoff_sem *h, const char *name)
+{
+    k_sem_init(&h->items, 0, HANDOFF_DEPTH);
+    k_sem_init(&h->slots, HANDOFF_DEPTH, HANDOFF_DEPTH);
+    h->head = 0;
+    h->tail = 0;
+    handoff_register(&h->ho, name);
+}
+
+/* Removes the oldest message, if the consumer did not take it meanwhile */
+static bool handoff_sem_steal(struct handoff_sem *h)
+{
+    k_spinlock_key_t key;
+
+    if (k_sem_take(&h->items, K_NO_WAIT) != 0) {
+        return false;
+    }
+
+    key = k_spin_lock(&h->lock);
+    h->tail = (h->tail + 1) % HANDOFF_DEPTH;
+    k_spin_unlock(&h->lock, key);
+    atomic_dec(&h->ho.level);
+
+    return true;
+}
+
+int handoff_sem_put(struct handoff_sem *h, const struct handoff_msg *msg)
+{
+    k_spinlock_key_t key;
+    int discarded = 0;
+
+    if (h->ho.policy == HANDOFF_COALESCE_LATEST) {
+        while (handoff_sem_steal(h)) {
+            k_sem_give(&h->slots);
+            atomic_inc(&h->ho.n_coalesced);
+            discarded++;
+        }
+    }
+
+    if (k_sem_take(&h->slots, K_NO_WAIT) != 0) {
+        if (h->ho.policy == HANDOFF_DROP_OLDEST && handoff_sem_steal(h)) {
+            /* The oldest message's slot is reused */
+            atomic_inc(&h->ho.n_dropped);
+            discarded++;
+        } else {
+            /* Backpressure, or the consumer is copying the last message out */
+            if (h->ho.policy == HANDOFF_BACKPRESSURE) {
+                atomic_inc(&h->ho.n_blocked);
+            }
+            k_sem_take(&h->slots, K_FOREVER);
+        }
+    }
+
+    key = k_spin_lock(&h->lock);
+    h->ring[h->head] = *msg;
+    h->head = (h->head + 1) % HANDOFF_DEPTH;
+    k_spin_unlock(&h->lock, key);
+
+    handoff_level_inc(&h->ho);
+    k_sem_give(&h->items);
+
+    return discarded;
+}
+
+void handoff_sem_get(struct handoff_sem *h, struct handoff_msg *msg)
+{
+    k_spinlock_key_t key;
+
+    k_sem_take(&h->items, K_FOREVER);
+
+    key = k_spin_lock(&h->lock);
+    *msg = h->ring[h->tail];
+    h->tail = (h->tail + 1) % HANDOFF_DEPTH;
+    k_spin_unlock(&h->lock, key);
+
+    atomic_dec(&h->ho.level);
+    k_sem_give(&h->slots);
+
+    seq_check_update(&h->ho.seq, msg->seq);
+}
+
+static uint32_t handoff_discards(const struct handoff *ho)
+{
+    return atomic_get(&ho->n_dropped) + atomic_get(&ho->n_coalesced);
+}
+
+uint32_t handoff_discarded(void)
+{
+    uint32_t n = 0;
+
+    for (int i = 0; i < n_handoffs; i++) {
+        n += handoff_discards(all_handoffs[i]);
+    }
+    return n;
+}
+
+/* Losses seen by hand-off 'idx' not explained by the discards up to it */
+static int32_t handoff_unexplained(int idx)
+{
+    uint32_t discards = 0;
+
+    for (int i = 0; i <= idx; i++) {
+        discards += handoff_discards(all_handoffs[i]);
+    }
+    return (int32_t)(all_handoffs[idx]->seq.lost - discards);
+}
+
+void handoff_print(const struct shell *sh)
+{
+    for (int i = 0; i < n_handoffs; i++) {
+        struct handoff *ho = all_handoffs[i];
+
+        app_print(sh, "%s: %s, depth %d, level %d (max %d), put %d, dropped %d, coalesced %d, blocked %d",
+            ho->name, handoff_policy_name(ho->policy), HANDOFF_DEPTH,
+            (int)atomic_get(&ho->level), (int)atomic_get(&ho->max_level),
+            (int)atomic_get(&ho->n_put), (int)atomic_get(&ho->n_dropped),
+            (int)atomic_get(&ho->n_coalesced), (int)atomic_get(&ho->n_blocked));
+        app_print(sh, "  seq: received %u, lost %u in %u gaps, reordered %u, unexplained %d",
+            ho->seq.received, ho->seq.lost, ho->seq.gaps, ho->seq.reordered,
+            handoff_unexplained(i));
+    }
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_handoff_show(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    handoff_print(sh);
+    return 0;
+}
+
+static int cmd_handoff_policy(const struct shell *sh, size_t argc, char **argv)
+{
+    for (int i = 0; i < n_handoffs; i++) {
+        if (strcmp(argv[1], all_handoffs[i]->name) != 0) {
+            continue;
+        }
+        for (int p = 0; p < ARRAY_SIZE(policy_names); p++) {
+            if (strcmp(argv[2], policy_names[p]) == 0) {
+                all_handoffs[i]->policy = (enum handoff_policy)p;
+                return 0;
+            }
+        }
+        shell_error(sh, "unknown policy %s (drop|coalesce|block)", argv[2]);
+        return -EINVAL;
+    }
+
+    shell_error(sh, "unknown hand-off %s", argv[1]);
+    return -EINVAL;
+}
+
+static int cmd_handoff_reset(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    for (int i = 0; i < n_handoffs; i++) {
+        struct handoff *ho = all_handoffs[i];
+
+        atomic_set(&ho->max_level, atomic_get(&ho->level));
+        atomic_clear(&ho->n_put);
+        atomic_clear(&ho->n_dropped);
+        atomic_clear(&ho->n_coalesced);
+        atomic_clear(&ho->n_blocked);
+        seq_check_reset(&ho->seq);
+    }
+    shell_print(sh, "hand-off counters reset");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_handoff,
+    SHELL_CMD(show, NULL, "Print policy and counters of each hand-off", cmd_handoff_show),
+    SHELL_CMD_ARG(policy, NULL, "Set overload policy: <hand-off> <drop|coalesce|block>",
+        cmd_handoff_policy, 3, 0),
+    SHELL_CMD(reset, NULL, "Clear the counters", cmd_handoff_reset),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(handoff, &sub_handoff, "Inter-stage hand-offs", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,114 @@
+/*
+ * Bounded hand-off between pipeline stages with an explicit overload policy
+ *
+ * Each hand-off holds at most CONFIG_APP_HANDOFF_DEPTH messages. When the
+ * consumer falls behind, the producer applies the hand-off's policy:
+ *  - HANDOFF_DROP_OLDEST: the oldest queued message is discarded
+ *  - HANDOFF_COALESCE_LATEST: all queued messages are replaced by the new
+ *    one (latest value wins)
+ *  - HANDOFF_BACKPRESSURE: the producer blocks until there is room
+ * Every discarded message and every blocking put is counted. The default
+ * policy comes from Kconfig and can be changed per hand-off at run time
+ * with the "handoff" shell command.
+ *
+ * Two flavours with the same semantics:
+ *  - handoff_fifo: k_fifo of blocks from a fixed k_mem_slab (Fifo app)
+ *  - handoff_sem: ring of slots guarded by an "items" and a "slots"
+ *    counting semaphore (Semaphores app)
+ * Messages are copied in and out, so no buffer is shared with the
+ * consumer after handoff_*_get() returns.
+ *
+ * The get functions check the sequence numbers (seq_check.h). Hand-offs
+ * are registered in pipeline order, so the losses seen by a consumer are
+ * explained by the discards of its own and all upstream hand-offs; the
+ * remainder is reported as "unexplained" and must be zero.
+ */
+
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include <zephyr.h>
+
+#include "seq_check.h"
+
+#define HANDOFF_DEPTH CONFIG_APP_HANDOFF_DEPTH
+
+enum handoff_policy {
+    HANDOFF_DROP_OLDEST,
+    HANDOFF_COALESCE_LATEST,
+    HANDOFF_BACKPRESSURE,
+};
+
+/* Payload passed between stages */
+struct handoff_msg {
+    uint32_t seq;           /* Sequence number, +1 per acquired sample */
+    uint16_t data;          /* Sample value (mV) */
+    uint32_t t_release;     /* ADC release instant (k_cycle_get_32) */
+    uint32_t t_sample;      /* End of conversion (sample_ts.h) */
+};
+
+/* Part common to both flavours: name, policy and counters */
+struct handoff {
+    const char *name;
+    enum handoff_policy policy;
+    atomic_t level;         /* Messages queued */
+    atomic_t max_level;
+    atomic_t n_put;
+    atomic_t n_dropped;
+    atomic_t n_coalesced;
+    atomic_t n_blocked;
+    struct seq_check seq;   /* Sequence numbers seen by the consumer */
+};
+
+/* k_fifo flavour */
+struct handoff_fifo_item {
+    void *fifo_reserved;    /* 1st word reserved for use by FIFO */
+    struct handoff_msg msg;
+};
+
+struct handoff_fifo {
+    struct handoff ho;
+    struct k_fifo fifo;
+    struct k_mem_slab *slab;
+};
+
+#define HANDOFF_FIFO_DEFINE(_name)                                         \
+    K_MEM_SLAB_DEFINE(_name##_slab, sizeof(struct handoff_fifo_item),  \
+        HANDOFF_DEPTH, 4);                                             \
+    struct handoff_fifo _name = { .slab = &_name##_slab }
+
+/* Semaphore flavour */
+struct handoff_sem {
+    struct handoff ho;
+    struct k_sem items;     /* Messages ready for the consumer */
+    struct k_sem slots;     /* Free slots for the producer */
+    struct k_spinlock lock;
+    uint8_t head, tail;
+    struct handoff_msg ring[HANDOFF_DEPTH];
+};
+
+#define HANDOFF_SEM_DEFINE(_name) struct handoff_sem _name
+
+/*
+ * Puts return the number of messages discarded by the policy to make room
+ * (0 when there was room or the producer blocked).
+ */
+void handoff_fifo_init(struct handoff_fifo *h, const char *name);
+int handoff_fifo_put(struct handoff_fifo *h, const struct handoff_msg *msg);
+void handoff_fifo_get(struct handoff_fifo *h, struct handoff_msg *msg);
+
+void handoff_sem_init(struct handoff_sem *h, const char *name);
+int handoff_sem_put(struct handoff_sem *h, const struct handoff_msg *msg);
+void handoff_sem_get(struct handoff_sem *h, struct handoff_msg *msg);
+
+const char *handoff_policy_name(enum handoff_policy policy);
+
+/* Messages dropped or coalesced by all hand-offs so far */
+uint32_t handoff_discarded(void);
+
+struct shell;
+
+/* Prints the counters of every hand-off to 'sh', or with printk when it is NULL */
+void handoff_print(const struct shell *sh);
+
+#endif /* HANDOFF_H */
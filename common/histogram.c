@@ -0,0 +1,26 @@
+/*
+ * Fixed-bucket histogram
+ */
+
+#include <string.h>
+
+#include "histogram.h"
+
+void histogram_reset(struct histogram *h)
+{
+    memset(h->buckets, 0, h->n_buckets * sizeof(h->buckets[0]));
+    h->underflow = 0;
+    h->overflow = 0;
+    h->count = 0;
+    h->min = INT32_MAX;
+    h->max = INT32_MIN;
+    h->sum = 0;
+}
+
+int32_t histogram_mean(const struct histogram *h)
+{
+    if (h->count == 0) {
+        return 0;
+    }
+    return (int32_t)(h->sum / h->count);
+}
@@ -0,0 +1,72 @@
+/*
+ * Fixed-bucket histogram
+ *
+ * Buckets of equal width starting at 'lo'; values below/above the range go
+ * to the underflow/overflow counters. Recording is O(1) and lock-free for a
+ * single writer. Plain C, no kernel dependencies.
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+struct histogram {
+    const char *name;
+    int32_t lo;                 /* lower bound of the first bucket */
+    uint32_t width;             /* bucket width */
+    uint32_t n_buckets;
+    uint32_t *buckets;
+    uint32_t underflow;
+    uint32_t overflow;
+    uint32_t count;
+    int32_t min;
+    int32_t max;
+    int64_t sum;
+};
+
+/* Defines a histogram '_name' of '_n' buckets of width '_width' from '_lo' */
+#define HISTOGRAM_DEFINE(_name, _label, _lo, _width, _n)        \
+    static uint32_t _name##_buckets[_n];                        \
+    struct histogram _name = {                                  \
+        .name = _label,                                         \
+        .lo = _lo,                                              \
+        .width = _width,                                        \
+        .n_buckets = _n,                                        \
+        .buckets = _name##_buckets,                             \
+        .min = INT32_MAX,                                       \
+        .max = INT32_MIN,                                       \
+    }
+
+/* Adds one value */
+static inline void histogram_record(struct histogram *h, int32_t value)
+{
+    if (value < h->lo) {
+        h->underflow++;
+    } else {
+        uint32_t idx = (uint32_t)(value - h->lo) / h->width;
+
+        if (idx < h->n_buckets) {
+            h->buckets[idx]++;
+        } else {
+            h->overflow++;
+        }
+    }
+
+    if (value < h->min) {
+        h->min = value;
+    }
+    if (value > h->max) {
+        h->max = value;
+    }
+    h->sum += value;
+    h->count++;
+}
+
+/* Clears all counters */
+void histogram_reset(struct histogram *h);
+
+/* Mean of the recorded values (0 if empty) */
+int32_t histogram_mean(const struct histogram *h);
+
+#endif /* HISTOGRAM_H */
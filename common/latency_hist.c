@@ -0,0 +1,94 @@
+/*
+ * Release-jitter and response-time histograms of the pipeline
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <shell/shell.h>
+#include <string.h>
+
+#include "latency_hist.h"
+#include "app_print.h"
+
+HISTOGRAM_DEFINE(hist_adc_jitter, "adc_jitter", 0,
+    CONFIG_APP_LATENCY_HIST_BUCKET_US, CONFIG_APP_LATENCY_HIST_BUCKETS);
+HISTOGRAM_DEFINE(hist_filtro_response, "filtro_response", 0,
+    CONFIG_APP_LATENCY_HIST_BUCKET_US, CONFIG_APP_LATENCY_HIST_BUCKETS);
+HISTOGRAM_DEFINE(hist_pwm_response, "pwm_response", 0,
+    CONFIG_APP_LATENCY_HIST_BUCKET_US, CONFIG_APP_LATENCY_HIST_BUCKETS);
+HISTOGRAM_DEFINE(hist_actuation, "actuation", 0,
+    CONFIG_APP_LATENCY_HIST_BUCKET_US, CONFIG_APP_LATENCY_HIST_BUCKETS);
+
+static struct histogram *const all_hist[] = {
+    &hist_adc_jitter,
+    &hist_filtro_response,
+    &hist_pwm_response,
+    &hist_actuation,
+};
+
+void latency_hist_reset(void)
+{
+    for (int i = 0; i < ARRAY_SIZE(all_hist); i++) {
+        histogram_reset(all_hist[i]);
+    }
+}
+
+static void hist_print(const struct shell *sh, const struct histogram *h)
+{
+    app_print(sh, "%s: n=%u min=%d max=%d mean=%d us (under %u, over %u)", h->name,
+        h->count, h->count ? h->min : 0, h->count ? h->max : 0,
+        histogram_mean(h), h->underflow, h->overflow);
+    for (uint32_t b = 0; b < h->n_buckets; b++) {
+        if (h->buckets[b]) {
+            app_print(sh, "  [%6d, %6d) %u", h->lo + (int32_t)(b * h->width),
+                h->lo + (int32_t)((b + 1) * h->width), h->buckets[b]);
+        }
+    }
+}
+
+void latency_hist_print(const struct shell *sh)
+{
+    for (int i = 0; i < ARRAY_SIZE(all_hist); i++) {
+        hist_print(sh, all_hist[i]);
+    }
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_hist_show(const struct shell *sh, size_t argc, char **argv)
+{
+    bool found = false;
+
+    for (int i = 0; i < ARRAY_SIZE(all_hist); i++) {
+        if (argc > 1 && strcmp(argv[1], all_hist[i]->name) != 0) {
+            continue;
+        }
+        hist_print(sh, all_hist[i]);
+        found = true;
+    }
+
+    if (!found) {
+        shell_error(sh, "unknown histogram %s", argv[1]);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+static int cmd_hist_reset(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    latency_hist_reset();
+    shell_print(sh, "histograms reset");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_hist,
+    SHELL_CMD_ARG(show, NULL, "Print histograms [adc_jitter|filtro_response|pwm_response|actuation]",
+        cmd_hist_show, 1, 1),
+    SHELL_CMD(reset, NULL, "Clear all histograms", cmd_hist_reset),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(hist, &sub_hist, "Release-jitter and response-time histograms", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,67 @@
+/*
+ * Release-jitter and response-time histograms of the pipeline
+ *
+ * All values are in microseconds:
+ *  - ADC jitter: actual release of thread_ADC_code minus its ideal instant
+ *    on the thread_ADC_period grid
+ *  - FILTRO/PWM response: end of the stage minus the ADC release that
+ *    produced the sample
+ *  - actuation: PWM update minus the end of the sample's conversion
+ *    (sample_ts.h)
+ *
+ * Dumped and reset with the "hist" shell command.
+ */
+
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <zephyr.h>
+
+#include "histogram.h"
+
+struct shell;
+
+#ifdef CONFIG_APP_LATENCY_HIST
+
+extern struct histogram hist_adc_jitter;
+extern struct histogram hist_filtro_response;
+extern struct histogram hist_pwm_response;
+extern struct histogram hist_actuation;
+
+/* Records the difference between two k_cycle_get_32() stamps, in us */
+static inline void latency_hist_record(struct histogram *h, uint32_t from_cyc, uint32_t to_cyc)
+{
+    int32_t diff = (int32_t)(to_cyc - from_cyc);
+
+    if (diff >= 0) {
+        histogram_record(h, (int32_t)k_cyc_to_us_floor32((uint32_t)diff));
+    } else {
+        histogram_record(h, -(int32_t)k_cyc_to_us_floor32((uint32_t)-diff));
+    }
+}
+
+/* Records a value already in us */
+static inline void latency_hist_record_us(struct histogram *h, uint32_t us)
+{
+    histogram_record(h, (int32_t)us);
+}
+
+/* Prints all histograms to 'sh', or with printk when it is NULL */
+void latency_hist_print(const struct shell *sh);
+
+/* Clears all histograms */
+void latency_hist_reset(void);
+
+#else
+
+#define latency_hist_record(h, from_cyc, to_cyc) do { ARG_UNUSED(from_cyc); ARG_UNUSED(to_cyc); } while (0)
+#define latency_hist_record_us(h, us) do { ARG_UNUSED(us); } while (0)
+static inline void latency_hist_print(const struct shell *sh)
+{
+    ARG_UNUSED(sh);
+}
+static inline void latency_hist_reset(void) {}
+
+#endif /* CONFIG_APP_LATENCY_HIST */
+
+#endif /* LATENCY_HIST_H */
@@ -0,0 +1,444 @@
+/*
+ * Multi-instance pipelines on a shared worker pool (see pipe_pool.h)
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <sys/slist.h>
+#include <shell/shell.h>
+#include <timing/timing.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe_pool.h"
+#include "pipeline_cfg.h"
+#include "filter.h"
+#include "fanin.h"
+#include "thread_stats.h"
+#include "sample_ts.h"
+
+#define POOL_WORKERS CONFIG_APP_PIPE_POOL_WORKERS
+#define POOL_PRIOS CONFIG_APP_PIPE_POOL_PRIOS
+
+/* Stack of each of the three threads of a Fifo/Semaphores pipeline */
+#define THREADED_STACK_SIZE 1024
+
+BUILD_ASSERT(POOL_PRIOS <= 32, "one ready bit per priority");
+
+enum pipe_stage {
+    PIPE_IDLE,
+    PIPE_SAMPLE,
+    PIPE_FILTER,
+    PIPE_OUTPUT,
+};
+
+struct pipe_inst {
+    sys_snode_t node;           /* in the ready queue of its priority */
+    struct k_timer timer;       /* release */
+    struct filter filt;
+    struct handoff_msg msg;     /* sample in flight, then latest output */
+    timing_t t_released;        /* release, for the latency (timing.h) */
+    pipe_source_fn source;
+    pipe_sink_fn sink;
+    void *user_data;
+    uint8_t stage;              /* next stage to run, PIPE_IDLE if none */
+    uint8_t prio;
+    bool running;
+    uint32_t n_done;
+    uint32_t n_overruns;
+    uint32_t n_errors;
+    uint32_t lat_max_us;        /* release to end of the output stage */
+    uint64_t lat_sum_us;
+};
+
+static struct pipe_inst insts[PIPE_POOL_INSTANCES];
+
+/* Ready instances, FIFO per priority; bit p of ready_mask set if ready[p] is not empty */
+static sys_slist_t ready[POOL_PRIOS];
+static uint32_t ready_mask;
+static struct k_spinlock ready_lock;
+static K_SEM_DEFINE(ready_sem, 0, K_SEM_MAX_LIMIT);
+
+static K_THREAD_STACK_ARRAY_DEFINE(worker_stacks, POOL_WORKERS, CONFIG_APP_PIPE_POOL_STACK_SIZE);
+static struct k_thread workers[POOL_WORKERS];
+static char worker_names[POOL_WORKERS][8];
+
+static uint32_t period_ms = CONFIG_APP_PIPE_POOL_PERIOD_MS;
+static unsigned int n_running;
+
+/* Called with ready_lock held */
+static void ready_push(struct pipe_inst *p, enum pipe_stage stage)
+{
+    p->stage = stage;
+    sys_slist_append(&ready[p->prio], &p->node);
+    ready_mask |= BIT(p->prio);
+}
+
+static struct pipe_inst *ready_pop(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&ready_lock);
+    struct pipe_inst *p = NULL;
+
+    if (ready_mask) {
+        unsigned int prio = __builtin_ctz(ready_mask);
+
+        p = CONTAINER_OF(sys_slist_get_not_empty(&ready[prio]), struct pipe_inst, node);
+        if (sys_slist_is_empty(&ready[prio])) {
+            ready_mask &= ~BIT(prio);
+        }
+    }
+    k_spin_unlock(&ready_lock, key);
+    return p;
+}
+
+/* Queues the next stage of 'p', or ends its sample with PIPE_IDLE */
+static void pipe_next(struct pipe_inst *p, enum pipe_stage stage)
+{
+    k_spinlock_key_t key = k_spin_lock(&ready_lock);
+
+    if (stage == PIPE_IDLE) {
+        p->stage = PIPE_IDLE;
+        k_spin_unlock(&ready_lock, key);
+        return;
+    }
+    ready_push(p, stage);
+    k_spin_unlock(&ready_lock, key);
+    k_sem_give(&ready_sem);
+}
+
+static void pipe_release(struct k_timer *timer)
+{
+    struct pipe_inst *p = CONTAINER_OF(timer, struct pipe_inst, timer);
+    k_spinlock_key_t key = k_spin_lock(&ready_lock);
+
+    if (p->stage != PIPE_IDLE) {
+        p->n_overruns++;
+        k_spin_unlock(&ready_lock, key);
+        return;
+    }
+    p->msg.t_release = k_cycle_get_32();
+    p->t_released = timing_counter_get();
+    ready_push(p, PIPE_SAMPLE);
+    k_spin_unlock(&ready_lock, key);
+    k_sem_give(&ready_sem);
+}
+
+/* Triangle of 400 mV around 1.5 V with an outlier every 16 samples;
+ * slope and phase differ per instance */
+static int synth_source(unsigned int id, void *user_data, uint16_t *mv)
+{
+    uint32_t n = insts[id].msg.seq;
+    uint32_t tri = (n * (id % 7 + 1) * 8 + id * 50) % 800;
+
+    ARG_UNUSED(user_data);
+
+    *mv = (uint16_t)(1300 + (tri < 400 ? tri : 800 - tri) + (n % 16 == 0 ? 600 : 0));
+    return 0;
+}
+
+static void default_sink(unsigned int id, void *user_data, const struct handoff_msg *msg)
+{
+    ARG_UNUSED(user_data);
+
+#ifdef CONFIG_APP_FANIN
+    /* Input 0 belongs to the main pipeline */
+    if (id + 1 < FANIN_INPUTS) {
+        fanin_put(id + 1, msg);
+    }
+#else
+    ARG_UNUSED(id);
+    ARG_UNUSED(msg);
+#endif
+}
+
+static void pipe_run_stage(struct pipe_inst *p)
+{
+    unsigned int id = p - insts;
+    timing_t now;
+    uint16_t mv;
+    uint32_t us;
+
+    switch (p->stage) {
+    case PIPE_SAMPLE:
+        if (p->source(id, p->user_data, &mv)) {
+            p->n_errors++;
+            pipe_next(p, PIPE_IDLE);
+            break;
+        }
+        p->msg.data = mv;
+        p->msg.t_sample = sample_ts_now();
+        pipe_next(p, PIPE_FILTER);
+        break;
+    case PIPE_FILTER:
+        p->msg.data = filter_update(&p->filt, p->msg.data);
+        pipe_next(p, PIPE_OUTPUT);
+        break;
+    case PIPE_OUTPUT:
+        p->sink(id, p->user_data, &p->msg);
+        now = timing_counter_get();
+        us = (uint32_t)(timing_cycles_to_ns(timing_cycles_get(&p->t_released, &now)) / 1000);
+        p->lat_max_us = MAX(p->lat_max_us, us);
+        p->lat_sum_us += us;
+        p->n_done++;
+        p->msg.seq++;
+        pipe_next(p, PIPE_IDLE);
+        break;
+    default:
+        break;
+    }
+}
+
+static void pool_worker(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    while (1) {
+        struct pipe_inst *p;
+
+        k_sem_take(&ready_sem, K_FOREVER);
+        p = ready_pop();
+        if (p) {
+            pipe_run_stage(p);
+        }
+    }
+}
+
+static bool pool_idle(void)
+{
+    for (int i = 0; i < PIPE_POOL_INSTANCES; i++) {
+        if (insts[i].stage != PIPE_IDLE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int pipe_pool_run(unsigned int n, uint32_t new_period_ms)
+{
+    struct pipeline_cfg cfg;
+
+    if (n > PIPE_POOL_INSTANCES || new_period_ms == 0) {
+        return -EINVAL;
+    }
+
+    for (int i = 0; i < PIPE_POOL_INSTANCES; i++) {
+        k_timer_stop(&insts[i].timer);
+        insts[i].running = false;
+    }
+    /* Samples already released finish before the state is reset */
+    for (int i = 0; i < 100 && !pool_idle(); i++) {
+        k_msleep(1);
+    }
+    if (!pool_idle()) {
+        return -EBUSY;
+    }
+
+    period_ms = new_period_ms;
+    n_running = n;
+    pipeline_cfg_get(&cfg);
+    for (int i = 0; i < n; i++) {
+        struct pipe_inst *p = &insts[i];
+
+        filter_init(&p->filt, cfg.filter_window);
+        memset(&p->msg, 0, sizeof(p->msg));
+        p->n_done = 0;
+        p->n_overruns = 0;
+        p->n_errors = 0;
+        p->lat_max_us = 0;
+        p->lat_sum_us = 0;
+        p->running = true;
+        /* Spread the releases over the period */
+        k_timer_start(&p->timer, K_USEC(period_ms * 1000U * (i + 1) / n),
+            K_MSEC(period_ms));
+    }
+    return 0;
+}
+
+int pipe_pool_bind(unsigned int id, pipe_source_fn source, pipe_sink_fn sink, void *user_data)
+{
+    if (id >= PIPE_POOL_INSTANCES || insts[id].running) {
+        return -EINVAL;
+    }
+    insts[id].source = source ? source : synth_source;
+    insts[id].sink = sink ? sink : default_sink;
+    insts[id].user_data = user_data;
+    return 0;
+}
+
+int pipe_pool_set_prio(unsigned int id, unsigned int prio)
+{
+    k_spinlock_key_t key;
+
+    if (id >= PIPE_POOL_INSTANCES || prio >= POOL_PRIOS) {
+        return -EINVAL;
+    }
+    /* Takes effect at the next release if the instance is queued now */
+    key = k_spin_lock(&ready_lock);
+    if (insts[id].stage == PIPE_IDLE) {
+        insts[id].prio = (uint8_t)prio;
+    }
+    k_spin_unlock(&ready_lock, key);
+    return insts[id].prio == prio ? 0 : -EBUSY;
+}
+
+struct pool_report {
+    uint32_t done;
+    uint32_t overruns;
+    uint32_t lat_max_us;
+    uint32_t lat_mean_us;
+    uint32_t ram_pool;
+    uint32_t ram_threaded;
+};
+
+/* RAM of n pipelines: instances plus the shared workers, against three
+ * threads with their own stacks and a filter per pipeline */
+static void pool_report(unsigned int n, struct pool_report *r)
+{
+    uint64_t sum = 0;
+
+    memset(r, 0, sizeof(*r));
+    for (int i = 0; i < n; i++) {
+        r->done += insts[i].n_done;
+        r->overruns += insts[i].n_overruns;
+        r->lat_max_us = MAX(r->lat_max_us, insts[i].lat_max_us);
+        sum += insts[i].lat_sum_us;
+    }
+    r->lat_mean_us = r->done ? (uint32_t)(sum / r->done) : 0;
+    r->ram_pool = n * sizeof(struct pipe_inst) +
+        POOL_WORKERS * (CONFIG_APP_PIPE_POOL_STACK_SIZE + sizeof(struct k_thread));
+    r->ram_threaded = n * (3 * (THREADED_STACK_SIZE + sizeof(struct k_thread)) +
+        sizeof(struct filter));
+}
+
+/* Pipelines per KB, x100 */
+static uint32_t per_kb_x100(unsigned int n, uint32_t ram)
+{
+    return ram ? n * 1024U * 100U / ram : 0;
+}
+
+static int pipe_pool_init(const struct device *dev)
+{
+    ARG_UNUSED(dev);
+
+    /* Cycle counter for the latencies; the system clock is too coarse */
+    timing_init();
+    timing_start();
+
+    for (int p = 0; p < POOL_PRIOS; p++) {
+        sys_slist_init(&ready[p]);
+    }
+    for (int i = 0; i < PIPE_POOL_INSTANCES; i++) {
+        k_timer_init(&insts[i].timer, pipe_release, NULL);
+        insts[i].source = synth_source;
+        insts[i].sink = default_sink;
+    }
+    for (int w = 0; w < POOL_WORKERS; w++) {
+        k_tid_t tid = k_thread_create(&workers[w], worker_stacks[w],
+            K_THREAD_STACK_SIZEOF(worker_stacks[w]), pool_worker, NULL, NULL, NULL,
+            CONFIG_APP_PIPE_POOL_PRIO, 0, K_NO_WAIT);
+
+        snprintk(worker_names[w], sizeof(worker_names[w]), "POOL%d", w);
+        thread_stats_register(tid, worker_names[w]);
+    }
+    return pipe_pool_run(CONFIG_APP_PIPE_POOL_START, period_ms);
+}
+
+SYS_INIT(pipe_pool_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#ifdef CONFIG_SHELL
+static int cmd_pool_show(const struct shell *sh, size_t argc, char **argv)
+{
+    struct pool_report r;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    pool_report(n_running, &r);
+    shell_print(sh, "%u of %d instances every %u ms on %d workers, %zu B per instance",
+        n_running, PIPE_POOL_INSTANCES, period_ms, POOL_WORKERS, sizeof(struct pipe_inst));
+    for (int i = 0; i < n_running; i++) {
+        const struct pipe_inst *p = &insts[i];
+
+        shell_print(sh, "  %2d: prio %u, %4u mV, %u done, %u overruns, %u errors, "
+            "latency mean %u max %u us", i, p->prio, p->msg.data, p->n_done, p->n_overruns,
+            p->n_errors, p->n_done ? (uint32_t)(p->lat_sum_us / p->n_done) : 0, p->lat_max_us);
+    }
+    shell_print(sh, "RAM %u B (%u.%02u pipelines/KB), with threads %u B (%u.%02u pipelines/KB)",
+        r.ram_pool, per_kb_x100(n_running, r.ram_pool) / 100,
+        per_kb_x100(n_running, r.ram_pool) % 100, r.ram_threaded,
+        per_kb_x100(n_running, r.ram_threaded) / 100,
+        per_kb_x100(n_running, r.ram_threaded) % 100);
+    return 0;
+}
+
+static int cmd_pool_run(const struct shell *sh, size_t argc, char **argv)
+{
+    uint32_t ms = argc > 2 ? strtoul(argv[2], NULL, 0) : period_ms;
+    int err = pipe_pool_run(strtoul(argv[1], NULL, 0), ms);
+
+    if (err) {
+        shell_error(sh, "pool run failed (%d): at most %d instances, period >= 1 ms",
+            err, PIPE_POOL_INSTANCES);
+    }
+    return err;
+}
+
+static int cmd_pool_prio(const struct shell *sh, size_t argc, char **argv)
+{
+    int err = pipe_pool_set_prio(strtoul(argv[1], NULL, 0), strtoul(argv[2], NULL, 0));
+
+    ARG_UNUSED(argc);
+
+    if (err) {
+        shell_error(sh, "pool prio failed (%d): priorities 0..%d", err, POOL_PRIOS - 1);
+    }
+    return err;
+}
+
+static int cmd_pool_sweep(const struct shell *sh, size_t argc, char **argv)
+{
+    static const uint8_t sizes[] = { 1, 8, 32 };
+    uint32_t ms = argc > 1 ? strtoul(argv[1], NULL, 0) : period_ms;
+    unsigned int restore = n_running;
+    uint32_t restore_ms = period_ms;
+    struct pool_report r;
+
+    shell_print(sh, "%d workers, %u ms period, %d ms per step", POOL_WORKERS, ms,
+        CONFIG_APP_PIPE_POOL_SWEEP_MS);
+    shell_print(sh, "%4s %8s %8s %8s %8s %9s %8s %9s", "N", "done", "overrun", "mean us",
+        "max us", "RAM B", "pipes/KB", "threads/KB");
+
+    for (int i = 0; i < ARRAY_SIZE(sizes); i++) {
+        if (sizes[i] > PIPE_POOL_INSTANCES) {
+            shell_print(sh, "%4u (above CONFIG_APP_PIPE_POOL_INSTANCES)", sizes[i]);
+            continue;
+        }
+        if (pipe_pool_run(sizes[i], ms)) {
+            shell_error(sh, "pool did not go idle");
+            return -EBUSY;
+        }
+        k_msleep(CONFIG_APP_PIPE_POOL_SWEEP_MS);
+        pool_report(sizes[i], &r);
+        shell_print(sh, "%4u %8u %8u %8u %8u %9u %5u.%02u %6u.%02u", sizes[i], r.done,
+            r.overruns, r.lat_mean_us, r.lat_max_us, r.ram_pool,
+            per_kb_x100(sizes[i], r.ram_pool) / 100, per_kb_x100(sizes[i], r.ram_pool) % 100,
+            per_kb_x100(sizes[i], r.ram_threaded) / 100,
+            per_kb_x100(sizes[i], r.ram_threaded) % 100);
+    }
+
+    return pipe_pool_run(restore, restore_ms);
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_pool,
+    SHELL_CMD(show, NULL, "Instances, latency and RAM use", cmd_pool_show),
+    SHELL_CMD_ARG(run, NULL, "Run instances: <n> [period ms]", cmd_pool_run, 2, 1),
+    SHELL_CMD_ARG(prio, NULL, "Set instance priority: <instance> <prio>", cmd_pool_prio, 3, 0),
+    SHELL_CMD_ARG(sweep, NULL, "Latency and RAM at 1, 8 and 32 instances: [period ms]",
+        cmd_pool_sweep, 1, 1),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(pool, &sub_pool, "Pipelines on the shared worker pool", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,51 @@
+/*
+ * Multi-instance pipelines on a shared worker pool
+ *
+ * A pipeline instance (sample -> filter -> output) is plain data: its
+ * filter state, latest message, release timer and source/sink bindings.
+ * No instance owns a thread. A k_timer per instance releases it every
+ * period; the released instance enters a ready queue ordered by its
+ * priority (0 = highest) and CONFIG_APP_PIPE_POOL_WORKERS worker threads
+ * run one stage at a time of the highest-priority ready instance, so a
+ * long low-priority pipeline yields between stages. A release that finds
+ * the previous sample still in flight is counted as an overrun.
+ *
+ * By default instances sample a synthetic per-instance signal; with
+ * CONFIG_APP_FANIN instance i feeds fan-in input i + 1 (input 0 is the
+ * main pipeline). pipe_pool_bind() attaches other sources and sinks.
+ *
+ * "pool sweep" runs 1, 8 and 32 instances in turn and reports the RAM per
+ * pipeline (pipelines per KB, against three threads per pipeline) and the
+ * release-to-output latency at each size.
+ */
+
+#ifndef PIPE_POOL_H
+#define PIPE_POOL_H
+
+#include <zephyr.h>
+
+#include "handoff.h"
+
+#ifdef CONFIG_APP_PIPE_POOL
+
+#define PIPE_POOL_INSTANCES CONFIG_APP_PIPE_POOL_INSTANCES
+
+/* Produces the next sample of instance 'id', in mV */
+typedef int (*pipe_source_fn)(unsigned int id, void *user_data, uint16_t *mv);
+
+/* Consumes the filtered sample of instance 'id' */
+typedef void (*pipe_sink_fn)(unsigned int id, void *user_data, const struct handoff_msg *msg);
+
+/* Replaces the source and sink of an instance (NULL keeps the default);
+ * only while the instance is stopped */
+int pipe_pool_bind(unsigned int id, pipe_source_fn source, pipe_sink_fn sink, void *user_data);
+
+/* Starts instances 0..n-1 with the given period, stops the others */
+int pipe_pool_run(unsigned int n, uint32_t period_ms);
+
+/* Sets the ready-queue priority of an instance (0 = highest) */
+int pipe_pool_set_prio(unsigned int id, unsigned int prio);
+
+#endif /* CONFIG_APP_PIPE_POOL */
+
+#endif /* PIPE_POOL_H */
@@ -0,0 +1,295 @@
+/*
+ * Pipeline sensor driver
+ */
+
+#define DT_DRV_COMPAT app_pipeline_sensor
+
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/sensor.h>
+#include <shell/shell.h>
+#include <stdlib.h>
+
+#include "pipe_sensor.h"
+#include "pipeline_cfg.h"
+#include "chan.h"
+
+#define PIPE_SENSOR_PENDING_DRDY BIT(0)
+#define PIPE_SENSOR_PENDING_THRESH BIT(1)
+
+struct pipe_sensor_config {
+    uint32_t size;
+    uint32_t watermark;
+};
+
+struct pipe_sensor_data {
+    const struct device *dev;
+    struct k_spinlock lock;
+    struct pipe_sensor_sample *ring;
+    uint32_t head;              /* samples received, also the ring write index */
+    uint32_t tail;              /* next unread sample */
+    uint32_t n_lost;            /* overwritten unread */
+    uint16_t fetched_mv;
+    bool fetched;
+    int32_t lower_mv;
+    int32_t upper_mv;
+    bool outside;               /* last sample outside the threshold band */
+    sensor_trigger_handler_t drdy_handler;
+    struct sensor_trigger drdy_trig;
+    sensor_trigger_handler_t thresh_handler;
+    struct sensor_trigger thresh_trig;
+    atomic_t pending;
+    struct k_work work;
+};
+
+/* Runs in the FILTRO thread: store and flag, handlers run from the work item */
+static void pipe_sensor_listener(const struct chan *ch, const struct handoff_msg *msg,
+                                 void *user_data)
+{
+    const struct device *dev = user_data;
+    const struct pipe_sensor_config *cfg = dev->config;
+    struct pipe_sensor_data *data = dev->data;
+    k_spinlock_key_t key;
+    atomic_val_t pending = 0;
+    bool outside = msg->data < data->lower_mv || msg->data > data->upper_mv;
+
+    ARG_UNUSED(ch);
+
+    key = k_spin_lock(&data->lock);
+    data->ring[data->head % cfg->size] = (struct pipe_sensor_sample){
+        .seq = msg->seq,
+        .t_release = msg->t_release,
+        .mv = msg->data,
+    };
+    data->head++;
+    if (data->head - data->tail > cfg->size) {
+        data->tail = data->head - cfg->size;
+        data->n_lost++;
+    }
+
+    if (data->drdy_handler && data->head - data->tail >= cfg->watermark) {
+        pending |= PIPE_SENSOR_PENDING_DRDY;
+    }
+    if (data->thresh_handler && outside && !data->outside) {
+        pending |= PIPE_SENSOR_PENDING_THRESH;
+    }
+    data->outside = outside;
+    k_spin_unlock(&data->lock, key);
+
+    if (pending) {
+        atomic_or(&data->pending, pending);
+        k_work_submit(&data->work);
+    }
+}
+
+static void pipe_sensor_work(struct k_work *work)
+{
+    struct pipe_sensor_data *data = CONTAINER_OF(work, struct pipe_sensor_data, work);
+    atomic_val_t pending = atomic_clear(&data->pending);
+
+    if ((pending & PIPE_SENSOR_PENDING_THRESH) && data->thresh_handler) {
+        data->thresh_handler(data->dev, &data->thresh_trig);
+    }
+    if ((pending & PIPE_SENSOR_PENDING_DRDY) && data->drdy_handler) {
+        data->drdy_handler(data->dev, &data->drdy_trig);
+    }
+}
+
+static int pipe_sensor_sample_fetch(const struct device *dev, enum sensor_channel chan)
+{
+    const struct pipe_sensor_config *cfg = dev->config;
+    struct pipe_sensor_data *data = dev->data;
+    k_spinlock_key_t key;
+    int err = 0;
+
+    if (chan != SENSOR_CHAN_ALL && chan != SENSOR_CHAN_VOLTAGE) {
+        return -ENOTSUP;
+    }
+
+    key = k_spin_lock(&data->lock);
+    if (data->head == 0) {
+        err = -ENODATA;
+    } else {
+        data->fetched_mv = data->ring[(data->head - 1) % cfg->size].mv;
+        data->fetched = true;
+    }
+    k_spin_unlock(&data->lock, key);
+    return err;
+}
+
+static int pipe_sensor_channel_get(const struct device *dev, enum sensor_channel chan,
+                                   struct sensor_value *val)
+{
+    struct pipe_sensor_data *data = dev->data;
+
+    if (chan != SENSOR_CHAN_VOLTAGE) {
+        return -ENOTSUP;
+    }
+    if (!data->fetched) {
+        return -ENODATA;
+    }
+    val->val1 = data->fetched_mv / 1000;
+    val->val2 = (data->fetched_mv % 1000) * 1000;
+    return 0;
+}
+
+static int32_t sensor_value_to_mv(const struct sensor_value *val)
+{
+    return val->val1 * 1000 + val->val2 / 1000;
+}
+
+static int pipe_sensor_attr_set(const struct device *dev, enum sensor_channel chan,
+                                enum sensor_attribute attr, const struct sensor_value *val)
+{
+    struct pipe_sensor_data *data = dev->data;
+    struct pipeline_cfg cfg;
+
+    if (chan != SENSOR_CHAN_VOLTAGE && chan != SENSOR_CHAN_ALL) {
+        return -ENOTSUP;
+    }
+
+    switch (attr) {
+    case SENSOR_ATTR_LOWER_THRESH:
+        data->lower_mv = sensor_value_to_mv(val);
+        return 0;
+    case SENSOR_ATTR_UPPER_THRESH:
+        data->upper_mv = sensor_value_to_mv(val);
+        return 0;
+    case SENSOR_ATTR_SAMPLING_FREQUENCY:
+        if (val->val1 <= 0 || val->val1 > 1000) {
+            return -EINVAL;
+        }
+        pipeline_cfg_staged_get(&cfg);
+        cfg.adc_period_ms = 1000 / val->val1;
+        return pipeline_cfg_set(&cfg);
+    default:
+        return -ENOTSUP;
+    }
+}
+
+static int pipe_sensor_trigger_set(const struct device *dev, const struct sensor_trigger *trig,
+                                   sensor_trigger_handler_t handler)
+{
+    struct pipe_sensor_data *data = dev->data;
+    k_spinlock_key_t key;
+    int err = 0;
+
+    key = k_spin_lock(&data->lock);
+    switch (trig->type) {
+    case SENSOR_TRIG_DATA_READY:
+        data->drdy_handler = handler;
+        data->drdy_trig = *trig;
+        break;
+    case SENSOR_TRIG_THRESHOLD:
+        data->thresh_handler = handler;
+        data->thresh_trig = *trig;
+        break;
+    default:
+        err = -ENOTSUP;
+        break;
+    }
+    k_spin_unlock(&data->lock, key);
+    return err;
+}
+
+size_t pipe_sensor_read_batch(const struct device *dev, struct pipe_sensor_sample *out,
+                              size_t max)
+{
+    const struct pipe_sensor_config *cfg = dev->config;
+    struct pipe_sensor_data *data = dev->data;
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+    size_t n = MIN((size_t)(data->head - data->tail), max);
+
+    for (size_t i = 0; i < n; i++) {
+        out[i] = data->ring[(data->tail + i) % cfg->size];
+    }
+    data->tail += n;
+    k_spin_unlock(&data->lock, key);
+
+    return n;
+}
+
+uint32_t pipe_sensor_unread(const struct device *dev)
+{
+    const struct pipe_sensor_data *data = dev->data;
+
+    return data->head - data->tail;
+}
+
+static int pipe_sensor_init(const struct device *dev)
+{
+    struct pipe_sensor_data *data = dev->data;
+
+    data->dev = dev;
+    data->lower_mv = INT32_MIN;
+    data->upper_mv = INT32_MAX;
+    k_work_init(&data->work, pipe_sensor_work);
+    return chan_listen(&chan_filtered, pipe_sensor_listener, (void *)dev);
+}
+
+static const struct sensor_driver_api pipe_sensor_api = {
+    .attr_set = pipe_sensor_attr_set,
+    .trigger_set = pipe_sensor_trigger_set,
+    .sample_fetch = pipe_sensor_sample_fetch,
+    .channel_get = pipe_sensor_channel_get,
+};
+
+#define PIPE_SENSOR_DEFINE(n)                                               \
+    BUILD_ASSERT(DT_INST_PROP(n, watermark) >= 1 &&                         \
+                 DT_INST_PROP(n, watermark) <= DT_INST_PROP(n, buffer_size), \
+                 "watermark must be 1..buffer-size");                       \
+    static struct pipe_sensor_sample pipe_sensor_ring_##n[DT_INST_PROP(n, buffer_size)]; \
+    static struct pipe_sensor_data pipe_sensor_data_##n = {                 \
+        .ring = pipe_sensor_ring_##n,                                       \
+    };                                                                      \
+    static const struct pipe_sensor_config pipe_sensor_config_##n = {       \
+        .size = DT_INST_PROP(n, buffer_size),                               \
+        .watermark = DT_INST_PROP(n, watermark),                            \
+    };                                                                      \
+    DEVICE_DT_INST_DEFINE(n, pipe_sensor_init, NULL, &pipe_sensor_data_##n, \
+                          &pipe_sensor_config_##n, POST_KERNEL,             \
+                          CONFIG_SENSOR_INIT_PRIORITY, &pipe_sensor_api);
+
+DT_INST_FOREACH_STATUS_OKAY(PIPE_SENSOR_DEFINE)
+
+#ifdef CONFIG_SHELL
+static int cmd_psensor_show(const struct shell *sh, size_t argc, char **argv)
+{
+    const struct device *dev = DEVICE_DT_GET(DT_DRV_INST(0));
+    const struct pipe_sensor_config *cfg = dev->config;
+    const struct pipe_sensor_data *data = dev->data;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    shell_print(sh, "%s: %u samples, %u unread of %u (watermark %u), %u lost", dev->name,
+        data->head, pipe_sensor_unread(dev), cfg->size, cfg->watermark, data->n_lost);
+    shell_print(sh, "triggers: data-ready %s, threshold %s [%d, %d] mV",
+        data->drdy_handler ? "on" : "off", data->thresh_handler ? "on" : "off",
+        data->lower_mv, data->upper_mv);
+    return 0;
+}
+
+/* Drains like a consumer would, printing one line per sample */
+static int cmd_psensor_read(const struct shell *sh, size_t argc, char **argv)
+{
+    const struct device *dev = DEVICE_DT_GET(DT_DRV_INST(0));
+    struct pipe_sensor_sample batch[16];
+    size_t max = argc > 1 ? MIN(strtoul(argv[1], NULL, 0), ARRAY_SIZE(batch)) : ARRAY_SIZE(batch);
+    size_t n = pipe_sensor_read_batch(dev, batch, max);
+
+    for (size_t i = 0; i < n; i++) {
+        shell_print(sh, "  #%u %u mV", batch[i].seq, batch[i].mv);
+    }
+    shell_print(sh, "%u read, %u left", (unsigned int)n, pipe_sensor_unread(dev));
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_psensor,
+    SHELL_CMD(show, NULL, "Buffer and trigger state", cmd_psensor_show),
+    SHELL_CMD_ARG(read, NULL, "Read unread samples: [max, up to 16]", cmd_psensor_read, 1, 1),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(psensor, &sub_psensor, "Pipeline sensor device", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,40 @@
+/*
+ * Pipeline sensor driver
+ *
+ * "app,pipeline-sensor" devicetree nodes expose the FILTRO output through
+ * the Zephyr sensor API, so other components need neither val_1 nor
+ * media_final. The driver listens on chan_filtered (chan.h) and keeps
+ * the last 'buffer-size' filtered samples:
+ *  - sensor_sample_fetch() latches the newest sample and
+ *    sensor_channel_get(SENSOR_CHAN_VOLTAGE) returns it in volts
+ *  - pipe_sensor_read_batch() drains unread samples, oldest first;
+ *    samples overwritten before being read are counted as lost
+ *  - SENSOR_TRIG_DATA_READY fires when 'watermark' samples are unread
+ *  - SENSOR_TRIG_THRESHOLD fires when the value leaves the band set with
+ *    SENSOR_ATTR_LOWER_THRESH / SENSOR_ATTR_UPPER_THRESH
+ *  - SENSOR_ATTR_SAMPLING_FREQUENCY stages a new ADC period
+ *    (pipeline_cfg.h)
+ * Trigger handlers run on the system workqueue, never in FILTRO.
+ */
+
+#ifndef PIPE_SENSOR_H
+#define PIPE_SENSOR_H
+
+#include <zephyr.h>
+#include <device.h>
+
+struct pipe_sensor_sample {
+    uint32_t seq;               /* pipeline sequence number */
+    uint32_t t_release;         /* ADC release (k_cycle_get_32) */
+    uint16_t mv;                /* filtered value */
+};
+
+/* Copies up to 'max' unread samples, oldest first, and marks them read;
+ * returns how many */
+size_t pipe_sensor_read_batch(const struct device *dev, struct pipe_sensor_sample *out,
+                              size_t max);
+
+/* Unread samples */
+uint32_t pipe_sensor_unread(const struct device *dev);
+
+#endif /* PIPE_SENSOR_H */
@@ -0,0 +1,269 @@
+/*
+ * Run-time configuration of the pipeline
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <shell/shell.h>
+#include <settings/settings.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "pipeline_cfg.h"
+#include "filter.h"
+#include "cyclic.h"
+
+static struct pipeline_cfg cfg_active = {
+    .adc_period_ms = CONFIG_APP_ADC_PERIOD_MS,
+    .filter_window = CONFIG_APP_FILTER_WINDOW,
+    .pwm_period_us = CONFIG_APP_PWM_PERIOD_US,
+};
+static struct pipeline_cfg cfg_staged;
+static bool cfg_pending;                    /* cfg_staged waiting for apply */
+static struct k_spinlock cfg_lock;
+
+void pipeline_cfg_get(struct pipeline_cfg *cfg)
+{
+    k_spinlock_key_t key = k_spin_lock(&cfg_lock);
+
+    *cfg = cfg_active;
+    k_spin_unlock(&cfg_lock, key);
+}
+
+void pipeline_cfg_staged_get(struct pipeline_cfg *cfg)
+{
+    k_spinlock_key_t key = k_spin_lock(&cfg_lock);
+
+    *cfg = cfg_pending ? cfg_staged : cfg_active;
+    k_spin_unlock(&cfg_lock, key);
+}
+
+static int pipeline_cfg_validate(const struct pipeline_cfg *cfg)
+{
+    if (cfg->adc_period_ms < 1 || cfg->adc_period_ms > PIPELINE_ADC_PERIOD_MAX_MS ||
+        cfg->filter_window < 1 || cfg->filter_window > FILTER_WINDOW_MAX ||
+        cfg->pwm_period_us < 1) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+int pipeline_cfg_set(const struct pipeline_cfg *cfg)
+{
+    k_spinlock_key_t key;
+
+    if (pipeline_cfg_validate(cfg)) {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&cfg_lock);
+    cfg_staged = *cfg;
+    cfg_pending = true;
+    k_spin_unlock(&cfg_lock, key);
+
+    return 0;
+}
+
+bool pipeline_cfg_apply(void)
+{
+    k_spinlock_key_t key;
+    bool changed = false;
+
+    key = k_spin_lock(&cfg_lock);
+    if (cfg_pending) {
+        cfg_active = cfg_staged;
+        cfg_pending = false;
+        changed = true;
+    }
+    k_spin_unlock(&cfg_lock, key);
+
+    return changed;
+}
+
+#ifdef CONFIG_APP_PIPELINE_CFG_SETTINGS
+static int pipeline_cfg_settings_set(const char *name, size_t len,
+                                     settings_read_cb read_cb, void *cb_arg)
+{
+    struct pipeline_cfg *cfg = &cfg_active;
+    uint32_t *field;
+    uint32_t val;
+    int rc;
+
+    if (!strcmp(name, "adc_period")) {
+        field = &cfg->adc_period_ms;
+    } else if (!strcmp(name, "window")) {
+        field = &cfg->filter_window;
+    } else if (!strcmp(name, "pwm_period")) {
+        field = &cfg->pwm_period_us;
+    } else {
+        return -ENOENT;
+    }
+
+    if (len != sizeof(val)) {
+        return -EINVAL;
+    }
+    rc = read_cb(cb_arg, &val, sizeof(val));
+    if (rc < 0) {
+        return rc;
+    }
+    *field = val;
+
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(pipeline, "pipeline", NULL,
+                               pipeline_cfg_settings_set, NULL, NULL);
+
+int pipeline_cfg_save(void)
+{
+    struct pipeline_cfg cfg;
+    int rc;
+
+    pipeline_cfg_get(&cfg);
+    rc = settings_save_one("pipeline/adc_period", &cfg.adc_period_ms, sizeof(uint32_t));
+    if (!rc) {
+        rc = settings_save_one("pipeline/window", &cfg.filter_window, sizeof(uint32_t));
+    }
+    if (!rc) {
+        rc = settings_save_one("pipeline/pwm_period", &cfg.pwm_period_us, sizeof(uint32_t));
+    }
+    return rc;
+}
+
+int pipeline_cfg_init(void)
+{
+    struct pipeline_cfg defaults = cfg_active;
+    int rc;
+
+    rc = settings_subsys_init();
+    if (rc) {
+        printk("settings_subsys_init() failed with code %d\n\r", rc);
+        return rc;
+    }
+    rc = settings_load_subtree("pipeline");
+
+    /* Ignore a corrupted or out-of-range record */
+    if (pipeline_cfg_validate(&cfg_active)) {
+        printk("pipeline settings invalid, using defaults\n\r");
+        cfg_active = defaults;
+    }
+    return rc;
+}
+#else
+int pipeline_cfg_save(void)
+{
+    return -ENOTSUP;
+}
+
+int pipeline_cfg_init(void)
+{
+    return 0;
+}
+#endif /* CONFIG_APP_PIPELINE_CFG_SETTINGS */
+
+#ifdef CONFIG_SHELL
+static void cfg_shell_print(const struct shell *sh, const char *title,
+                            const struct pipeline_cfg *cfg)
+{
+    shell_print(sh, "%s: adc_period %u ms, window %u, pwm_period %u us", title,
+        cfg->adc_period_ms, cfg->filter_window, cfg->pwm_period_us);
+}
+
+static int cmd_pcfg_show(const struct shell *sh, size_t argc, char **argv)
+{
+    struct pipeline_cfg active, staged;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    pipeline_cfg_get(&active);
+    cfg_shell_print(sh, "active", &active);
+    pipeline_cfg_staged_get(&staged);
+    if (memcmp(&staged, &active, sizeof(staged))) {
+        cfg_shell_print(sh, "staged", &staged);
+    }
+    return 0;
+}
+
+/* Whole unsigned number, no trailing characters, no overflow */
+static int pcfg_arg(const char *arg, uint32_t *val)
+{
+    char *end;
+    unsigned long v;
+
+    errno = 0;
+    v = strtoul(arg, &end, 0);
+    if (end == arg || *end != '\0' || errno || v > UINT32_MAX) {
+        return -EINVAL;
+    }
+    *val = (uint32_t)v;
+    return 0;
+}
+
+/* Stages a change of one field; argv[0] selects the field */
+static int cmd_pcfg_field(const struct shell *sh, size_t argc, char **argv)
+{
+    struct pipeline_cfg cfg;
+    uint32_t val;
+
+    ARG_UNUSED(argc);
+
+    if (pcfg_arg(argv[1], &val)) {
+        shell_error(sh, "invalid number %s", argv[1]);
+        return -EINVAL;
+    }
+
+    pipeline_cfg_staged_get(&cfg);
+    if (!strcmp(argv[0], "adc_period")) {
+        if (cyclic_enabled()) {
+            shell_error(sh, "sampling period set by the cyclic schedule");
+            return -ENOTSUP;
+        }
+        if (IS_ENABLED(CONFIG_APP_ADC_LIMIT)) {
+            shell_error(sh, "sampling rate set by CONFIG_APP_ADC_LIMIT_RATE_HZ");
+            return -ENOTSUP;
+        }
+        cfg.adc_period_ms = val;
+    } else if (!strcmp(argv[0], "window")) {
+        cfg.filter_window = val;
+    } else {
+        cfg.pwm_period_us = val;
+    }
+
+    if (pipeline_cfg_set(&cfg)) {
+        shell_error(sh, "invalid value %s (adc_period max %d ms, window max %d)", argv[1],
+            PIPELINE_ADC_PERIOD_MAX_MS, FILTER_WINDOW_MAX);
+        return -EINVAL;
+    }
+    shell_print(sh, "staged, applied at the next sample");
+    return 0;
+}
+
+static int cmd_pcfg_save(const struct shell *sh, size_t argc, char **argv)
+{
+    int rc;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    rc = pipeline_cfg_save();
+    if (rc) {
+        shell_error(sh, "save failed with code %d", rc);
+        return rc;
+    }
+    shell_print(sh, "saved");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_pcfg,
+    SHELL_CMD(show, NULL, "Print active (and staged) configuration", cmd_pcfg_show),
+    SHELL_CMD_ARG(adc_period, NULL, "<ms> Sampling period", cmd_pcfg_field, 2, 0),
+    SHELL_CMD_ARG(window, NULL, "<n> Filter window (samples)", cmd_pcfg_field, 2, 0),
+    SHELL_CMD_ARG(pwm_period, NULL, "<us> PWM period", cmd_pcfg_field, 2, 0),
+    SHELL_CMD(save, NULL, "Persist the active configuration", cmd_pcfg_save),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(pcfg, &sub_pcfg, "Pipeline run-time configuration", NULL);
+#endif /* CONFIG_SHELL */
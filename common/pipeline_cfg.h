@@ -0,0 +1,50 @@
+/*
+ * Run-time configuration of the pipeline
+ *
+ * Sampling period, filter window and PWM period live in an active block
+ * and a staged one. Changes are staged and made active by the ADC thread
+ * before its next sample (pipeline_cfg_apply()): at the next period in
+ * the periodic and cyclic modes, at the next delivered conversion with
+ * CONFIG_APP_ADC_LIMIT. A sample is never processed with a mix of old and
+ * new settings.
+ *
+ * Readers take a copy once per sample (pipeline_cfg_get()); the copy is
+ * made under a spinlock, so it is never torn by a concurrent apply. With
+ * CONFIG_APP_PIPELINE_CFG_SETTINGS the values are also persisted with the
+ * settings subsystem under "pipeline/".
+ */
+
+#ifndef PIPELINE_CFG_H
+#define PIPELINE_CFG_H
+
+#include <zephyr.h>
+
+/* Longest sampling period; wavecomp.h chunks keep it in 16 bits */
+#define PIPELINE_ADC_PERIOD_MAX_MS UINT16_MAX
+
+struct pipeline_cfg {
+    uint32_t adc_period_ms;     /* thread_ADC_code period */
+    uint32_t filter_window;     /* samples in the FILTRO window */
+    uint32_t pwm_period_us;     /* PWM period */
+};
+
+/* Loads the persisted settings, if enabled. Call before starting the threads */
+int pipeline_cfg_init(void);
+
+/* Copies the active configuration */
+void pipeline_cfg_get(struct pipeline_cfg *cfg);
+
+/* Copies the staged configuration, or the active one if nothing is staged */
+void pipeline_cfg_staged_get(struct pipeline_cfg *cfg);
+
+/* Validates and stages a new configuration for the next period boundary */
+int pipeline_cfg_set(const struct pipeline_cfg *cfg);
+
+/* Makes the staged configuration active; returns true if it changed.
+ * Called only by the ADC thread, before it takes a sample. */
+bool pipeline_cfg_apply(void);
+
+/* Writes the active configuration to flash (-ENOTSUP without settings) */
+int pipeline_cfg_save(void);
+
+#endif /* PIPELINE_CFG_H */
@@ -0,0 +1,89 @@
+/*
+ * Statistics of the FILTRO stage
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <shell/shell.h>
+
+#include "pipeline_stats.h"
+#include "stats.h"
+
+static struct stats_acc input_stats;
+static struct stats_acc output_stats;
+static struct stats_window window_stats;   /* copy of the filter's */
+static bool have_window;
+static atomic_t reset_pending;
+static struct k_spinlock lock;
+
+void pipeline_stats_update(const struct filter *f, uint16_t sample, uint16_t filtered)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    /* Reset by the writer, so a snapshot never races a half-cleared state */
+    if (atomic_clear(&reset_pending)) {
+        stats_reset(&input_stats);
+        stats_reset(&output_stats);
+    }
+
+    stats_add(&input_stats, sample);
+    stats_add(&output_stats, filtered);
+    window_stats = f->stats;
+    have_window = true;
+    k_spin_unlock(&lock, key);
+}
+
+#ifdef CONFIG_SHELL
+static void stats_shell_print(const struct shell *sh, const char *name,
+                              const struct stats_snapshot *s)
+{
+    shell_print(sh, "%-8s n=%u min=%u max=%u mean=%u.%02u var=%u.%02u (mV, mV^2)", name,
+        s->count, s->min, s->max, s->mean_q8 >> 8, (s->mean_q8 & 0xff) * 100 >> 8,
+        s->var_q8 >> 8, (s->var_q8 & 0xff) * 100 >> 8);
+}
+
+static int cmd_stats_show(const struct shell *sh, size_t argc, char **argv)
+{
+    struct stats_snapshot in, out, win;
+    k_spinlock_key_t key;
+    bool window;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    /* All three from the same sample */
+    key = k_spin_lock(&lock);
+    stats_snapshot(&input_stats, &in);
+    stats_snapshot(&output_stats, &out);
+    window = have_window;
+    if (window) {
+        stats_window_snapshot(&window_stats, &win);
+    }
+    k_spin_unlock(&lock, key);
+
+    stats_shell_print(sh, "input", &in);
+    stats_shell_print(sh, "filtered", &out);
+    if (window) {
+        stats_shell_print(sh, "window", &win);
+    }
+    return 0;
+}
+
+static int cmd_stats_reset(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    atomic_set(&reset_pending, 1);
+    shell_print(sh, "lifetime statistics restart with the next sample");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_stats,
+    SHELL_CMD(show, NULL, "Lifetime and window statistics", cmd_stats_show),
+    SHELL_CMD(reset, NULL, "Restart the lifetime statistics", cmd_stats_reset),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(fstats, &sub_stats, "FILTRO statistics", NULL);
+#endif /* CONFIG_SHELL */
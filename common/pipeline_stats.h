@@ -0,0 +1,34 @@
+/*
+ * Statistics of the FILTRO stage
+ *
+ * FILTRO reports each input sample and its filtered value; lifetime
+ * statistics of both are kept (stats.h), and the filter's own window
+ * statistics are copied without recomputation. The shell reads all of
+ * them under one lock. Shown and reset with the "fstats" shell command.
+ */
+
+#ifndef PIPELINE_STATS_H
+#define PIPELINE_STATS_H
+
+#include <zephyr.h>
+
+#include "filter.h"
+
+#ifdef CONFIG_APP_PIPELINE_STATS
+
+/* Accounts for one sample (mV) filtered by 'f' into 'filtered' */
+void pipeline_stats_update(const struct filter *f, uint16_t sample, uint16_t filtered);
+
+#else
+
+static inline void pipeline_stats_update(const struct filter *f, uint16_t sample,
+                                         uint16_t filtered)
+{
+    ARG_UNUSED(f);
+    ARG_UNUSED(sample);
+    ARG_UNUSED(filtered);
+}
+
+#endif /* CONFIG_APP_PIPELINE_STATS */
+
+#endif /* PIPELINE_STATS_H */
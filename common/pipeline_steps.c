@@ -0,0 +1,373 @@
+/*
+ * Stage steps of the ADC -> FILTRO -> PWM pipeline
+ */
+
+#include <zephyr.h>
+#include <device.h>
+#include <devicetree.h>
+#include <drivers/pwm.h>
+#include <drivers/adc.h>
+#include <sys/printk.h>
+
+#include "pipeline_steps.h"
+#include "trace_markers.h"
+#include "latency_hist.h"
+#include "pipeline_cfg.h"
+#include "convert.h"
+#include "adc_waveform.h"
+#include "replay.h"
+#include "sample_ts.h"
+#include "stress.h"
+#include "adc_limit.h"
+#include "adaptive_rate.h"
+#include "adc_decim.h"
+#include "spectrum.h"
+#include "pipeline_stats.h"
+#include "chan.h"
+#include "cyclic.h"
+#include "ppi_bypass.h"
+#include "flight_rec.h"
+#include "wave_hist.h"
+#include "thread_stats.h"
+
+#define PWM0_NID DT_NODELABEL(pwm0) 
+#define BOARDLED_PIN 0x0e
+
+/*ADC definitions and includes*/
+#if defined(CONFIG_ADC_NRFX_SAADC) || defined(CONFIG_APP_ADC_LIMIT)
+#include <hal/nrf_saadc.h>
+#endif
+#define ADC_NID DT_NODELABEL(adc) 
+#define ADC_RESOLUTION 10
+#define ADC_GAIN ADC_GAIN_1_4
+#define ADC_REFERENCE ADC_REF_VDD_1_4
+#if defined(CONFIG_ADC_NRFX_SAADC) || defined(CONFIG_APP_ADC_LIMIT)
+#define ADC_ACQUISITION_TIME ADC_ACQ_TIME(ADC_ACQ_TIME_MICROSECONDS, 40)
+#else
+/* The ADC emulator (native_posix) only accepts the default acquisition time */
+#define ADC_ACQUISITION_TIME ADC_ACQ_TIME_DEFAULT
+#endif
+#define ADC_CHANNEL_ID PIPELINE_ADC_CHANNEL_ID
+
+/* This is the actual nRF ANx input to use. Note that a channel can be assigned to any ANx. In fact a channel can */
+/*    be assigned to two ANx, when differential reading is set (one ANx for the positive signal and the other one for the negative signal) */  
+/* Note also that the configuration of differnt channels is completely independent (gain, resolution, ref voltage, ...) */
+#define ADC_CHANNEL_INPUT NRF_SAADC_INPUT_AIN1 
+
+#define BUFFER_SIZE 1
+
+/* ADC channel configuration */
+static const struct adc_channel_cfg my_channel_cfg = {
+	.gain = ADC_GAIN,
+	.reference = ADC_REFERENCE,
+	.acquisition_time = ADC_ACQUISITION_TIME,
+	.channel_id = ADC_CHANNEL_ID,
+#ifdef CONFIG_ADC_CONFIGURABLE_INPUTS
+	.input_positive = ADC_CHANNEL_INPUT
+#endif
+};
+
+/* Global vars */
+static const struct device *adc_dev = NULL;
+static uint16_t adc_sample_buffer[BUFFER_SIZE];
+static uint32_t adc_sample_ts;      /* End of conversion of adc_sample_buffer (sample_ts.h) */
+static uint32_t adc_seq;            /* Sequence number of the next sample handed to FILTRO */
+static pipeline_put_fn put_sample;  /* Hand-off to FILTRO of the application */
+
+/* Last acquired and filtered values */
+static int val_1 = 0;
+static int media_final = 0;
+
+void pipeline_steps_init(pipeline_put_fn put)
+{
+    put_sample = put;
+}
+
+/* Takes one sample */
+static int adc_sample(void)
+{
+	int ret;
+	struct adc_sequence sequence = {
+		.channels = BIT(ADC_CHANNEL_ID),
+		.buffer = adc_sample_buffer,
+		.buffer_size = sizeof(adc_sample_buffer),
+		.resolution = ADC_RESOLUTION,
+	};
+
+	if (adc_dev == NULL) {
+            printk("adc_sample(): error, must bind to adc first \n\r");
+            return -1;
+	}
+
+	/* Optionally a block of conversions, decimated into adc_sample_buffer[0] */
+	adc_decim_attach(&sequence, &adc_sample_buffer[0]);
+
+	ret = adc_read(adc_dev, &sequence);
+	adc_sample_ts = sample_ts_get();
+	if (ret) {
+            printk("adc_read() failed with code %d\n", ret);
+	}	
+
+	return ret;
+}
+
+/* Hands adc_sample_buffer to FILTRO (stress and event-driven modes) */
+static void adc_hand_off(void)
+{
+    struct handoff_msg msg;
+
+    trace_mark(TRACE_MARK_SAMPLE_ACQUIRED, adc_sample_buffer[0]);
+    flight_rec_log(FLIGHT_REC_SAMPLE, adc_seq, adc_sample_buffer[0], 0);
+
+    val_1 = convert_raw_to_mv(adc_sample_buffer[0]);
+    msg.data = val_1;
+    msg.t_release = k_cycle_get_32();
+    msg.t_sample = adc_sample_ts;
+    msg.seq = adc_seq++;
+    put_sample(&msg);
+}
+
+/* Saturation test: one sample through the pipeline, no console output */
+int pipeline_stress_sample(void)
+{
+    static uint16_t ramp;
+    int err = 0;
+
+    if (IS_ENABLED(CONFIG_APP_STRESS_SYNTHETIC)) {
+        adc_sample_buffer[0] = ramp++ % (ADC_MAX_RAW + 1);
+        adc_sample_ts = sample_ts_now();
+    } else {
+        err = adc_sample();
+    }
+    if (err) {
+        return err;
+    }
+    adc_hand_off();
+
+    return 0;
+}
+
+#ifdef CONFIG_APP_ADC_LIMIT
+/* Event-driven acquisition: a conversion taken by the SAADC on its own */
+static void limit_sample(uint16_t raw)
+{
+    /* Each delivered conversion is a period boundary for staged settings */
+    pipeline_cfg_apply();
+
+    adc_sample_buffer[0] = raw;
+    adc_sample_ts = sample_ts_get();
+    adc_hand_off();
+}
+
+int pipeline_limit_run(void)
+{
+    sample_ts_init();
+    return adc_limit_run(&my_channel_cfg, ADC_CHANNEL_INPUT, ADC_RESOLUTION, limit_sample);
+}
+#else
+int pipeline_limit_run(void)
+{
+    return -ENOTSUP;
+}
+#endif
+
+/* Binds and configures the ADC and the acquisition helpers */
+int pipeline_adc_setup(void)
+{
+    int err;
+
+    /* ADC setup: bind and initialize */
+    adc_dev = device_get_binding(DT_LABEL(ADC_NID));
+	if (!adc_dev) {
+        printk("ADC device_get_binding() failed\n");
+    } 
+    err = adc_channel_setup(adc_dev, &my_channel_cfg);
+    if (err) {
+        printk("adc_channel_setup() failed with error code %d\n", err);
+    }
+    
+    /* It is recommended to calibrate the SAADC at least once before use, and whenever the ambient temperature has changed by more than 10 °C */
+#ifdef CONFIG_ADC_NRFX_SAADC
+    NRF_SAADC->TASKS_CALIBRATEOFFSET = 1;
+#endif
+
+    /* Emulated ADC (native_posix): drive the channel with a scripted waveform */
+    adc_waveform_attach(adc_dev, ADC_CHANNEL_ID);
+
+    /* Stamp every conversion at its end (hardware capture when available) */
+    if (sample_ts_init()) {
+        printk("sample_ts_init() failed, samples are not timestamped\n\r");
+    }
+
+    return adc_decim_init();
+}
+
+/* One acquisition: sample (or replayed sample) into a message for FILTRO.
+ * Returns -ENODATA at the end of a replay */
+int pipeline_adc_step(struct handoff_msg *msg, uint32_t release_cyc)
+{
+    int err;
+
+    if (replay_enabled()) {
+        /* Replay: take the next recorded sample instead */
+        err = replay_next(&adc_sample_buffer[0]);
+        if (err == -ENODATA) {
+            return err;
+        }
+        adc_sample_ts = sample_ts_now();
+    } else {
+        err=adc_sample();
+    }
+    val_1=convert_raw_to_mv(adc_sample_buffer[0]);
+    trace_mark(TRACE_MARK_SAMPLE_ACQUIRED, adc_sample_buffer[0]);
+    flight_rec_log(FLIGHT_REC_SAMPLE, adc_seq, adc_sample_buffer[0], 0);
+    
+    if(err) 
+    {
+        flight_rec_log(FLIGHT_REC_ADC_ERROR, adc_seq, 0, (int16_t)err);
+        printk("adc_sample() failed with error code %d\n\r",err);
+    }
+    else 
+    {
+        if(adc_sample_buffer[0] > 1023) 
+        {
+            printk("adc reading out of range\n\r");
+        }
+        else if (IS_ENABLED(CONFIG_APP_SAMPLE_LOG) && !replay_enabled() && !cyclic_enabled())
+        {
+            /* ADC is set to use gain of 1/4 and reference VDD/4, so input range is 0...VDD (3 V), with 10 bit resolution */
+            printk("adc reading: raw:%4u / %4u mV: \n\r",adc_sample_buffer[0],convert_raw_to_mv(adc_sample_buffer[0]));
+        }
+    }
+
+    msg->data = val_1;
+    msg->t_release = release_cyc;
+    msg->t_sample = adc_sample_ts;
+    msg->seq = adc_seq++;
+
+    return err;
+}
+
+/* Filters one sample; 'out' (may be 'in') keeps the stamps of 'in' */
+void pipeline_filter_step(struct filter *filt, const struct handoff_msg *in,
+                          struct handoff_msg *out)
+{
+    struct pipeline_cfg cfg;
+    uint16_t sample = in->data;
+
+    /* A new window keeps the most recent samples that fit */
+    pipeline_cfg_get(&cfg);
+    if (cfg.filter_window != filt->window) {
+        filter_set_window(filt, cfg.filter_window);
+    }
+
+    media_final = filter_update(filt, sample);
+    flight_rec_log(FLIGHT_REC_FILTER, in->seq, media_final, 0);
+    adc_limit_recenter(media_final);
+    adaptive_rate_update(sample, media_final);
+    pipeline_stats_update(filt, sample, media_final);
+    wave_hist_record(in->t_release, sample, media_final);
+    out->data = media_final;
+    out->t_release = in->t_release;
+    out->t_sample = in->t_sample;
+    out->seq = in->seq;
+
+    trace_mark(TRACE_MARK_FILTER_DONE, out->data);
+    latency_hist_record(&hist_filtro_response, out->t_release, k_cycle_get_32());
+}
+
+/* Drives the PWM output from one filtered sample */
+void pipeline_pwm_step(const struct device *pwm_dev, const struct handoff_msg *msg)
+{
+    struct pipeline_cfg cfg;
+    unsigned int pwmPeriod_us;
+    unsigned int val_duty = convert_mv_to_duty(msg->data);
+    int ret_pwm = 0;
+
+    pipeline_cfg_get(&cfg);
+    pwmPeriod_us = cfg.pwm_period_us;
+
+    if (IS_ENABLED(CONFIG_APP_SAMPLE_LOG) && !replay_enabled() && !stress_enabled() &&
+        !cyclic_enabled()) {
+        printk("PWM DC value set to %u %%\n\r",val_duty);
+    }
+
+    /* The hardware bypass holds the output until it is re-armed */
+    if (ppi_bypass_pwm_allowed(msg->data)) {
+        ret_pwm = pwm_pin_set_usec(pwm_dev, BOARDLED_PIN,
+          pwmPeriod_us, (pwmPeriod_us*val_duty)/100, PWM_POLARITY_NORMAL);
+        ppi_bypass_pwm_updated();
+    }
+    flight_rec_log(FLIGHT_REC_PWM, msg->seq, val_duty, (int16_t)ret_pwm);
+    trace_mark(TRACE_MARK_PWM_SET, val_duty);
+    replay_record_duty(val_duty);
+    stress_note_done();
+    latency_hist_record(&hist_pwm_response, msg->t_release, k_cycle_get_32());
+    latency_hist_record_us(&hist_actuation, sample_ts_delta_us(msg->t_sample, sample_ts_now()));
+   /* if (ret_pwm) 
+    {
+        printk("Error %d: failed to set pulse width\n", ret_pwm);
+        return;
+    }*/
+}
+
+#ifdef CONFIG_APP_CYCLIC
+/* Steps run by the cyclic executive instead of the pipeline threads */
+static struct handoff_msg cyc_sample;
+static struct handoff_msg cyc_filtered;
+static struct filter cyc_filt;
+static const struct device *cyc_pwm_dev;
+
+static void cyclic_adc(void)
+{
+    pipeline_cfg_apply();
+    pipeline_adc_step(&cyc_sample, cyclic_frame_start());
+    spectrum_push(val_1);
+}
+
+static void cyclic_filter(void)
+{
+    pipeline_filter_step(&cyc_filt, &cyc_sample, &cyc_filtered);
+    chan_publish(&chan_filtered, &cyc_filtered);
+}
+
+static void cyclic_pwm(void)
+{
+    pipeline_pwm_step(cyc_pwm_dev, &cyc_filtered);
+}
+
+void pipeline_cyclic_start(void)
+{
+    static const cyclic_step_fn steps[CYCLIC_STEP_COUNT] = {
+        [CYCLIC_STEP_ADC] = cyclic_adc,
+        [CYCLIC_STEP_FILTER] = cyclic_filter,
+        [CYCLIC_STEP_PWM] = cyclic_pwm,
+    };
+    struct pipeline_cfg cfg;
+    k_tid_t tid;
+
+    if (pipeline_adc_setup()) {
+        return;
+    }
+    cyc_pwm_dev = device_get_binding(DT_LABEL(PWM0_NID));
+    if (cyc_pwm_dev == NULL) {
+        printk("Error: Failed to bind to PWM0\n\r");
+        return;
+    }
+    /* The schedule sets the sampling period: publish it for the consumers
+     * of adc_period_ms (spectrum, waveform history) */
+    pipeline_cfg_get(&cfg);
+    cfg.adc_period_ms = cyclic_adc_period_ms();
+    if (pipeline_cfg_set(&cfg)) {
+        printk("Error: no ADC step in the cyclic schedule\n\r");
+        return;
+    }
+    pipeline_cfg_apply();
+    filter_init(&cyc_filt, cfg.filter_window);
+
+    tid = cyclic_start(steps);
+    if (tid) {
+        thread_stats_register(tid, "CYCLIC");
+    }
+}
+#endif /* CONFIG_APP_CYCLIC */
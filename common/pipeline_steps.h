@@ -0,0 +1,54 @@
+/*
+ * Stage steps of the ADC -> FILTRO -> PWM pipeline
+ *
+ * The work of each stage for one sample, shared by the Fifo and
+ * Semaphores applications: the applications keep their threads and their
+ * inter-stage hand-off (k_fifo or semaphores, handoff.h) and call these
+ * steps from them. The acquisition modes that produce samples outside the
+ * periodic ADC loop (saturation test, SAADC limit events) pass them on
+ * through the put hook given to pipeline_steps_init(). The cyclic
+ * executive (cyclic.h) runs the same steps without hand-offs.
+ */
+
+#ifndef PIPELINE_STEPS_H
+#define PIPELINE_STEPS_H
+
+#include <zephyr.h>
+#include <device.h>
+
+#include "handoff.h"
+#include "filter.h"
+
+/* SAADC channel of the pipeline input */
+#define PIPELINE_ADC_CHANNEL_ID 1
+
+/* Hands a sample to FILTRO through the application's hand-off */
+typedef int (*pipeline_put_fn)(const struct handoff_msg *msg);
+
+/* Sets the hand-off used by the stress and event-driven modes */
+void pipeline_steps_init(pipeline_put_fn put_sample);
+
+/* Binds and configures the ADC and the acquisition helpers */
+int pipeline_adc_setup(void);
+
+/* One acquisition: sample (or replayed sample) into a message for FILTRO.
+ * Returns -ENODATA at the end of a replay */
+int pipeline_adc_step(struct handoff_msg *msg, uint32_t release_cyc);
+
+/* Filters one sample; 'out' (may be 'in') keeps the stamps of 'in' */
+void pipeline_filter_step(struct filter *filt, const struct handoff_msg *in,
+                          struct handoff_msg *out);
+
+/* Drives the PWM output from one filtered sample */
+void pipeline_pwm_step(const struct device *pwm_dev, const struct handoff_msg *msg);
+
+/* Saturation test: one sample through the pipeline (stress_sample_fn) */
+int pipeline_stress_sample(void);
+
+/* Event-driven acquisition on SAADC limit events; returns only on error */
+int pipeline_limit_run(void);
+
+/* Starts the cyclic executive running all three steps */
+void pipeline_cyclic_start(void);
+
+#endif /* PIPELINE_STEPS_H */
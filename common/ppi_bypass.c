@@ -0,0 +1,232 @@
+/*
+ * Hardware over-limit bypass: SAADC -> PPI -> PWM (nRF52)
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <shell/shell.h>
+#include <nrfx_ppi.h>
+#include <hal/nrf_saadc.h>
+#include <hal/nrf_pwm.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ppi_bypass.h"
+#include "convert.h"
+#include "pipeline_steps.h"
+
+#define BYPASS_ADC_CH PIPELINE_ADC_CHANNEL_ID
+
+/* PWM0 channel of the LED pin (ch0-pin in the board overlay) */
+#define BYPASS_PWM NRF_PWM0
+#define BYPASS_PWM_CH 0
+
+/* Polarity bit of a PWM sequence value */
+#define PWM_VALUE_POLARITY BIT(15)
+
+static struct ppi_bypass_cfg bypass_cfg = {
+    .mode = IS_ENABLED(CONFIG_APP_PPI_BYPASS_SAFE_DUTY_MODE) ?
+        PPI_BYPASS_SAFE_DUTY : PPI_BYPASS_STOP,
+    .limit_mv = CONFIG_APP_PPI_BYPASS_LIMIT_MV,
+    .safe_duty = CONFIG_APP_PPI_BYPASS_SAFE_DUTY,
+};
+
+static nrf_ppi_channel_t bypass_ppi;
+static bool ppi_allocated;
+static bool tripped;
+static uint32_t n_trips;
+static uint32_t n_held;             /* PWM updates held back while tripped */
+static uint32_t last_trip_ms;
+
+/* Sequence 1: the safe duty, in the LOAD=Individual layout of pwm_nrfx */
+static nrf_pwm_values_individual_t safe_seq;
+
+static nrf_saadc_event_t limit_event(void)
+{
+    return nrf_saadc_limit_event_get(BYPASS_ADC_CH, NRF_SAADC_LIMIT_HIGH);
+}
+
+static int16_t mv_to_raw(uint16_t mv)
+{
+    return (int16_t)MIN((uint32_t)mv * ADC_MAX_RAW / ADC_FULL_SCALE_MV,
+        (uint32_t)NRF_SAADC_LIMITH_DISABLED);
+}
+
+static nrf_pwm_task_t bypass_task(void)
+{
+    return bypass_cfg.mode == PPI_BYPASS_SAFE_DUTY ? NRF_PWM_TASK_SEQSTART1 : NRF_PWM_TASK_STOP;
+}
+
+int ppi_bypass_configure(const struct ppi_bypass_cfg *cfg)
+{
+    if (cfg->safe_duty > 100) {
+        return -EINVAL;
+    }
+    if (!ppi_allocated) {
+        if (nrfx_ppi_channel_alloc(&bypass_ppi) != NRFX_SUCCESS) {
+            return -EBUSY;
+        }
+        ppi_allocated = true;
+    }
+
+    nrfx_ppi_channel_disable(bypass_ppi);
+    bypass_cfg = *cfg;
+
+    if (bypass_cfg.mode == PPI_BYPASS_DISABLED) {
+        nrf_saadc_channel_limits_set(NRF_SAADC, BYPASS_ADC_CH, NRF_SAADC_LIMITL_DISABLED,
+            NRF_SAADC_LIMITH_DISABLED);
+        tripped = false;
+        return 0;
+    }
+
+    nrf_saadc_channel_limits_set(NRF_SAADC, BYPASS_ADC_CH, NRF_SAADC_LIMITL_DISABLED,
+        mv_to_raw(bypass_cfg.limit_mv));
+    nrfx_ppi_channel_assign(bypass_ppi,
+        nrf_saadc_event_address_get(NRF_SAADC, limit_event()),
+        nrf_pwm_task_address_get(BYPASS_PWM, bypass_task()));
+    ppi_bypass_rearm();
+    nrfx_ppi_channel_enable(bypass_ppi);
+    return 0;
+}
+
+void ppi_bypass_rearm(void)
+{
+    nrf_saadc_event_clear(NRF_SAADC, limit_event());
+    tripped = false;
+}
+
+bool ppi_bypass_pwm_allowed(uint16_t mv)
+{
+    if (bypass_cfg.mode == PPI_BYPASS_DISABLED) {
+        return true;
+    }
+
+    if (!tripped && nrf_saadc_event_check(NRF_SAADC, limit_event())) {
+        tripped = true;
+        n_trips++;
+        last_trip_ms = k_uptime_get_32();
+    }
+
+    if (tripped && IS_ENABLED(CONFIG_APP_PPI_BYPASS_AUTO_REARM) &&
+        mv + CONFIG_APP_PPI_BYPASS_HYSTERESIS_MV < bypass_cfg.limit_mv) {
+        ppi_bypass_rearm();
+    }
+
+    if (tripped) {
+        n_held++;
+    }
+    return !tripped;
+}
+
+void ppi_bypass_pwm_updated(void)
+{
+    const uint16_t *seq0 = (const uint16_t *)(uintptr_t)BYPASS_PWM->SEQ[0].PTR;
+    uint16_t top = (uint16_t)BYPASS_PWM->COUNTERTOP;
+    uint16_t *safe = (uint16_t *)&safe_seq;
+
+    if (bypass_cfg.mode == PPI_BYPASS_SAFE_DUTY && seq0 != NULL) {
+        /* Same values as sequence 0 except the duty of our channel */
+        memcpy(&safe_seq, seq0, sizeof(safe_seq));
+        safe[BYPASS_PWM_CH] = (seq0[BYPASS_PWM_CH] & PWM_VALUE_POLARITY) |
+            (uint16_t)((uint32_t)top * bypass_cfg.safe_duty / 100);
+
+        /* Play sequence 0 once and hold it, so sequence 1 only runs on a trip */
+        nrf_pwm_shorts_disable(BYPASS_PWM, NRF_PWM_SHORT_LOOPSDONE_SEQSTART0_MASK);
+        nrf_pwm_loop_set(BYPASS_PWM, 0);
+        nrf_pwm_seq_ptr_set(BYPASS_PWM, 1, safe);
+        nrf_pwm_seq_cnt_set(BYPASS_PWM, 1, NRF_PWM_VALUES_LENGTH(safe_seq));
+        nrf_pwm_seq_refresh_set(BYPASS_PWM, 1, 0);
+        nrf_pwm_seq_end_delay_set(BYPASS_PWM, 1, 0);
+    }
+
+    /* A trip between the check and the update must not be undone */
+    if (bypass_cfg.mode != PPI_BYPASS_DISABLED &&
+        nrf_saadc_event_check(NRF_SAADC, limit_event())) {
+        nrf_pwm_task_trigger(BYPASS_PWM, bypass_task());
+    }
+}
+
+static int ppi_bypass_init(const struct device *dev)
+{
+    int err;
+
+    ARG_UNUSED(dev);
+
+    err = ppi_bypass_configure(&bypass_cfg);
+    if (err) {
+        printk("ppi_bypass: no PPI channel (%d)\n\r", err);
+    }
+    return err;
+}
+
+SYS_INIT(ppi_bypass_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#ifdef CONFIG_SHELL
+static const char *const mode_names[] = {
+    [PPI_BYPASS_DISABLED] = "off",
+    [PPI_BYPASS_STOP] = "stop",
+    [PPI_BYPASS_SAFE_DUTY] = "safe",
+};
+
+static int cmd_bypass_show(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    shell_print(sh, "mode %s, limit %u mV, safe duty %u %%, %s", mode_names[bypass_cfg.mode],
+        bypass_cfg.limit_mv, bypass_cfg.safe_duty, tripped ? "TRIPPED" : "armed");
+    shell_print(sh, "%u trips (last at %u ms), %u PWM updates held", n_trips, last_trip_ms,
+        n_held);
+    return 0;
+}
+
+static int cmd_bypass_set(const struct shell *sh, size_t argc, char **argv)
+{
+    struct ppi_bypass_cfg cfg = bypass_cfg;
+    int mode = -1;
+    int err;
+
+    for (int m = 0; m < ARRAY_SIZE(mode_names); m++) {
+        if (strcmp(argv[1], mode_names[m]) == 0) {
+            mode = m;
+        }
+    }
+    if (mode < 0) {
+        shell_error(sh, "unknown mode %s (off|stop|safe)", argv[1]);
+        return -EINVAL;
+    }
+    cfg.mode = (enum ppi_bypass_mode)mode;
+    if (argc > 2) {
+        cfg.limit_mv = (uint16_t)strtoul(argv[2], NULL, 0);
+    }
+    if (argc > 3) {
+        cfg.safe_duty = (uint8_t)strtoul(argv[3], NULL, 0);
+    }
+
+    err = ppi_bypass_configure(&cfg);
+    if (err) {
+        shell_error(sh, "bypass set failed (%d)", err);
+    }
+    return err;
+}
+
+static int cmd_bypass_rearm(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(sh);
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    ppi_bypass_rearm();
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_bypass,
+    SHELL_CMD(show, NULL, "Mode, limit and trips", cmd_bypass_show),
+    SHELL_CMD_ARG(set, NULL, "Configure: <off|stop|safe> [limit mV] [safe duty %]",
+        cmd_bypass_set, 2, 2),
+    SHELL_CMD(rearm, NULL, "Give the output back to the pipeline", cmd_bypass_rearm),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(bypass, &sub_bypass, "SAADC -> PWM hardware bypass", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,68 @@
+/*
+ * Hardware over-limit bypass: SAADC -> PPI -> PWM (nRF52)
+ *
+ * A PPI channel connects the SAADC LIMITH event of the pipeline channel
+ * straight to a PWM0 task, so a conversion above the limit acts on the
+ * output within a PWM clock, with no interrupt and no thread involved:
+ *  - PPI_BYPASS_STOP: TASKS_STOP, the output goes to its idle (off) level
+ *  - PPI_BYPASS_SAFE_DUTY: TASKS_SEQSTART[1], sequence 1 holds a duty
+ *    preloaded by ppi_bypass_pwm_updated()
+ *
+ * The software pipeline stays the normal path. The PWM stage asks
+ * ppi_bypass_pwm_allowed() before every update: once the bypass tripped,
+ * updates are held back until it is re-armed ("bypass rearm", or
+ * automatically when the filtered value falls below the limit minus the
+ * hysteresis with CONFIG_APP_PPI_BYPASS_AUTO_REARM), so software never
+ * overrides the hardware reaction. Mode, limit and safe duty can be
+ * changed at run time with ppi_bypass_configure() or "bypass set".
+ *
+ * The safe duty mode relies on pwm_nrfx restarting playback on every
+ * pwm_pin_set(): sequence 1 is repointed and looping turned off after
+ * each update, and the PWM then holds the last value of sequence 0.
+ */
+
+#ifndef PPI_BYPASS_H
+#define PPI_BYPASS_H
+
+#include <zephyr.h>
+
+enum ppi_bypass_mode {
+    PPI_BYPASS_DISABLED,
+    PPI_BYPASS_STOP,
+    PPI_BYPASS_SAFE_DUTY,
+};
+
+struct ppi_bypass_cfg {
+    enum ppi_bypass_mode mode;
+    uint16_t limit_mv;          /* trips above this input */
+    uint8_t safe_duty;          /* percent, PPI_BYPASS_SAFE_DUTY only */
+};
+
+#ifdef CONFIG_APP_PPI_BYPASS
+
+/* Applies a new configuration and re-arms */
+int ppi_bypass_configure(const struct ppi_bypass_cfg *cfg);
+
+/* Clears a trip; the next PWM update drives the output again */
+void ppi_bypass_rearm(void);
+
+/* Called by the PWM stage with the filtered value before updating the
+ * output; false while the bypass holds it */
+bool ppi_bypass_pwm_allowed(uint16_t mv);
+
+/* Called right after every pwm_pin_set() */
+void ppi_bypass_pwm_updated(void);
+
+#else
+
+static inline bool ppi_bypass_pwm_allowed(uint16_t mv)
+{
+    ARG_UNUSED(mv);
+    return true;
+}
+
+static inline void ppi_bypass_pwm_updated(void) {}
+
+#endif /* CONFIG_APP_PPI_BYPASS */
+
+#endif /* PPI_BYPASS_H */
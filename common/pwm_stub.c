@@ -0,0 +1,148 @@
+/*
+ * Stub PWM driver
+ */
+
+#define DT_DRV_COMPAT app_pwm_stub
+
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/pwm.h>
+#include <shell/shell.h>
+
+#include "pwm_stub.h"
+
+#define PWM_STUB_HZ 1000000U
+
+struct pwm_stub_data {
+    struct k_spinlock lock;
+    struct pwm_stub_event *history;
+    size_t size;
+    uint32_t count;             /* total updates, also the ring write index */
+};
+
+static int pwm_stub_pin_set(const struct device *dev, uint32_t pwm,
+                            uint32_t period_cycles, uint32_t pulse_cycles,
+                            pwm_flags_t flags)
+{
+    struct pwm_stub_data *data = dev->data;
+    struct pwm_stub_event *ev;
+    k_spinlock_key_t key;
+
+    ARG_UNUSED(flags);
+
+    if (pulse_cycles > period_cycles) {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&data->lock);
+    ev = &data->history[data->count % data->size];
+    ev->timestamp_ms = k_uptime_get_32();
+    ev->channel = pwm;
+    ev->period_us = period_cycles;
+    ev->pulse_us = pulse_cycles;
+    data->count++;
+    k_spin_unlock(&data->lock, key);
+
+    return 0;
+}
+
+static int pwm_stub_get_cycles_per_sec(const struct device *dev, uint32_t pwm,
+                                       uint64_t *cycles)
+{
+    ARG_UNUSED(dev);
+    ARG_UNUSED(pwm);
+
+    *cycles = PWM_STUB_HZ;
+    return 0;
+}
+
+uint32_t pwm_stub_update_count(const struct device *dev)
+{
+    const struct pwm_stub_data *data = dev->data;
+
+    return data->count;
+}
+
+size_t pwm_stub_history_get(const struct device *dev, struct pwm_stub_event *out, size_t max)
+{
+    struct pwm_stub_data *data = dev->data;
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+    size_t n = MIN(MIN((size_t)data->count, data->size), max);
+    uint32_t first = data->count - n;
+
+    for (size_t i = 0; i < n; i++) {
+        out[i] = data->history[(first + i) % data->size];
+    }
+    k_spin_unlock(&data->lock, key);
+
+    return n;
+}
+
+void pwm_stub_history_clear(const struct device *dev)
+{
+    struct pwm_stub_data *data = dev->data;
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+    data->count = 0;
+    k_spin_unlock(&data->lock, key);
+}
+
+static int pwm_stub_init(const struct device *dev)
+{
+    ARG_UNUSED(dev);
+    return 0;
+}
+
+static const struct pwm_driver_api pwm_stub_api = {
+    .pin_set = pwm_stub_pin_set,
+    .get_cycles_per_sec = pwm_stub_get_cycles_per_sec,
+};
+
+#define PWM_STUB_DEFINE(n)                                                  \
+    static struct pwm_stub_event pwm_stub_history_##n[DT_INST_PROP(n, history_size)]; \
+    static struct pwm_stub_data pwm_stub_data_##n = {                       \
+        .history = pwm_stub_history_##n,                                    \
+        .size = DT_INST_PROP(n, history_size),                              \
+    };                                                                      \
+    DEVICE_DT_INST_DEFINE(n, pwm_stub_init, NULL, &pwm_stub_data_##n, NULL, \
+                          POST_KERNEL, CONFIG_KERNEL_INIT_PRIORITY_DEVICE,  \
+                          &pwm_stub_api);
+
+DT_INST_FOREACH_STATUS_OKAY(PWM_STUB_DEFINE)
+
+#ifdef CONFIG_SHELL
+static int cmd_pwmstub_show(const struct shell *sh, size_t argc, char **argv)
+{
+    const struct device *dev = DEVICE_DT_GET(DT_DRV_INST(0));
+    struct pwm_stub_event ev[16];
+    size_t n = pwm_stub_history_get(dev, ev, ARRAY_SIZE(ev));
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    shell_print(sh, "%u updates, last %u:", pwm_stub_update_count(dev), (unsigned int)n);
+    for (size_t i = 0; i < n; i++) {
+        shell_print(sh, "  %8u ms ch %u: %u / %u us", ev[i].timestamp_ms,
+            ev[i].channel, ev[i].pulse_us, ev[i].period_us);
+    }
+    return 0;
+}
+
+static int cmd_pwmstub_clear(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    pwm_stub_history_clear(DEVICE_DT_GET(DT_DRV_INST(0)));
+    shell_print(sh, "history cleared");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_pwmstub,
+    SHELL_CMD(show, NULL, "Print the recorded duty updates", cmd_pwmstub_show),
+    SHELL_CMD(clear, NULL, "Forget the recorded duty updates", cmd_pwmstub_clear),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(pwmstub, &sub_pwmstub, "Stub PWM duty history", NULL);
+#endif /* CONFIG_SHELL */
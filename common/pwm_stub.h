@@ -0,0 +1,31 @@
+/*
+ * Stub PWM driver
+ *
+ * Stands in for the nRF PWM on native_posix: pin_set() only records the
+ * request (channel, period, pulse, time) in a history ring, so the whole
+ * pipeline can run and be checked on a host machine. One cycle is 1 us.
+ */
+
+#ifndef PWM_STUB_H
+#define PWM_STUB_H
+
+#include <zephyr.h>
+#include <device.h>
+
+struct pwm_stub_event {
+    uint32_t timestamp_ms;      /* k_uptime_get_32() at the update */
+    uint32_t channel;
+    uint32_t period_us;
+    uint32_t pulse_us;
+};
+
+/* Number of updates since boot (or the last clear) */
+uint32_t pwm_stub_update_count(const struct device *dev);
+
+/* Copies up to 'max' most recent updates, oldest first; returns how many */
+size_t pwm_stub_history_get(const struct device *dev, struct pwm_stub_event *out, size_t max);
+
+/* Forgets all recorded updates */
+void pwm_stub_history_clear(const struct device *dev);
+
+#endif /* PWM_STUB_H */
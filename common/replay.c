@@ -0,0 +1,156 @@
+/*
+ * Trace replay source
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <stdlib.h>
+
+#ifdef CONFIG_ARCH_POSIX
+#include <stdio.h>
+#else
+#include <storage/flash_map.h>
+#endif
+
+#include "replay.h"
+
+static K_SEM_DEFINE(replay_done_sem, 0, 1);
+
+static uint32_t n_samples;
+static uint32_t start_cyc;
+
+#ifdef CONFIG_ARCH_POSIX
+static FILE *trace_file;
+static FILE *duty_file;
+
+static int replay_source_open(void)
+{
+    trace_file = fopen(CONFIG_APP_REPLAY_FILE, "r");
+    if (trace_file == NULL) {
+        printk("replay: cannot open %s\n\r", CONFIG_APP_REPLAY_FILE);
+        return -ENOENT;
+    }
+
+    duty_file = fopen(CONFIG_APP_REPLAY_OUTPUT, "w");
+    if (duty_file == NULL) {
+        printk("replay: cannot create %s\n\r", CONFIG_APP_REPLAY_OUTPUT);
+        fclose(trace_file);
+        return -EIO;
+    }
+    return 0;
+}
+
+static int replay_source_next(uint16_t *raw)
+{
+    unsigned int val;
+
+    if (fscanf(trace_file, "%u", &val) != 1) {
+        return -ENODATA;
+    }
+    *raw = (uint16_t)val;
+    return 0;
+}
+
+static void replay_duty_out(uint32_t n, unsigned int duty)
+{
+    fprintf(duty_file, "%u %u\n", n, duty);
+}
+
+static void replay_source_close(void)
+{
+    fclose(trace_file);
+    fclose(duty_file);
+}
+#else
+static const struct flash_area *trace_fa;
+static uint32_t trace_count;
+
+static int replay_source_open(void)
+{
+    struct replay_flash_header hdr;
+    int rc;
+
+    rc = flash_area_open(FLASH_AREA_ID(storage), &trace_fa);
+    if (rc) {
+        printk("replay: flash_area_open() failed with code %d\n\r", rc);
+        return rc;
+    }
+
+    rc = flash_area_read(trace_fa, 0, &hdr, sizeof(hdr));
+    if (rc || hdr.magic != REPLAY_FLASH_MAGIC ||
+        sizeof(hdr) + hdr.count * sizeof(uint16_t) > trace_fa->fa_size) {
+        printk("replay: no valid trace in the storage partition\n\r");
+        flash_area_close(trace_fa);
+        return -ENOENT;
+    }
+    trace_count = hdr.count;
+
+    return 0;
+}
+
+static int replay_source_next(uint16_t *raw)
+{
+    if (n_samples >= trace_count) {
+        return -ENODATA;
+    }
+    return flash_area_read(trace_fa, sizeof(struct replay_flash_header) +
+                           n_samples * sizeof(uint16_t), raw, sizeof(*raw));
+}
+
+static void replay_duty_out(uint32_t n, unsigned int duty)
+{
+    printk("D %u %u\n\r", n, duty);
+}
+
+static void replay_source_close(void)
+{
+    flash_area_close(trace_fa);
+}
+#endif /* CONFIG_ARCH_POSIX */
+
+int replay_open(void)
+{
+    int rc = replay_source_open();
+
+    if (rc == 0) {
+        printk("replay: started\n\r");
+        n_samples = 0;
+        start_cyc = k_cycle_get_32();
+    }
+    return rc;
+}
+
+int replay_next(uint16_t *raw)
+{
+    int rc = replay_source_next(raw);
+
+    if (rc == 0) {
+        n_samples++;
+    } else if (rc != -ENODATA) {
+        /* A failed read would fail again at the same offset: end the replay */
+        printk("replay: reading sample %u failed with code %d, replay stopped\n\r",
+            n_samples, rc);
+        rc = -ENODATA;
+    }
+    return rc;
+}
+
+void replay_record_duty(unsigned int duty)
+{
+    replay_duty_out(n_samples, duty);
+    k_sem_give(&replay_done_sem);
+}
+
+void replay_wait_done(void)
+{
+    k_sem_take(&replay_done_sem, K_FOREVER);
+}
+
+void replay_finish(void)
+{
+    uint64_t elapsed_us = k_cyc_to_us_floor64(k_cycle_get_32() - start_cyc);
+
+    replay_source_close();
+    printk("replay: %u samples in %llu us, %llu samples/s\n\r", n_samples, elapsed_us,
+        elapsed_us ? (uint64_t)n_samples * 1000000U / elapsed_us : 0);
+}
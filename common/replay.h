@@ -0,0 +1,61 @@
+/*
+ * Trace replay source
+ *
+ * Stands in for adc_sample(): raw ADC values are read from a recorded trace
+ * (a text file on native_posix, the "storage" flash partition on target)
+ * and pushed through FILTRO and PWM as fast as they consume them, ignoring
+ * the sampling period. At the end of the trace the throughput is reported;
+ * every duty cycle set by PWM is written out (file or console) so runs can
+ * be diffed offline.
+ *
+ * Trace formats:
+ *  - file: one raw value per line (e.g. captured "adc reading: raw:" values)
+ *  - flash: struct replay_flash_header followed by 'count' uint16_t values,
+ *    see scripts/replay_image.py
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <zephyr.h>
+
+#define REPLAY_FLASH_MAGIC 0x59504c52   /* "RLPY" */
+
+struct replay_flash_header {
+    uint32_t magic;
+    uint32_t count;
+};
+
+static inline bool replay_enabled(void)
+{
+    return IS_ENABLED(CONFIG_APP_REPLAY);
+}
+
+#ifdef CONFIG_APP_REPLAY
+
+/* Opens the trace and the duty output */
+int replay_open(void);
+
+/* Next raw sample; -ENODATA at the end of the trace or after a read error */
+int replay_next(uint16_t *raw);
+
+/* Called by PWM once a replayed sample reached the output */
+void replay_record_duty(unsigned int duty);
+
+/* Blocks the source until PWM consumed the previous sample */
+void replay_wait_done(void);
+
+/* Prints the throughput and closes the trace and the output */
+void replay_finish(void);
+
+#else
+
+static inline int replay_open(void) { return -ENOTSUP; }
+static inline int replay_next(uint16_t *raw) { ARG_UNUSED(raw); return -ENOTSUP; }
+static inline void replay_record_duty(unsigned int duty) { ARG_UNUSED(duty); }
+static inline void replay_wait_done(void) {}
+static inline void replay_finish(void) {}
+
+#endif /* CONFIG_APP_REPLAY */
+
+#endif /* REPLAY_H */
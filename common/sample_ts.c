@@ -0,0 +1,61 @@
+/*
+ * Sample timestamps: TIMER2 captured by PPI on SAADC END (nRF52)
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <nrfx_ppi.h>
+#include <hal/nrf_saadc.h>
+#include <hal/nrf_timer.h>
+
+#include "sample_ts.h"
+
+#define SAMPLE_TS_TIMER NRF_TIMER2
+#define SAMPLE_TS_CC_SAMPLE NRF_TIMER_CC_CHANNEL0   /* Captured by PPI */
+#define SAMPLE_TS_CC_NOW NRF_TIMER_CC_CHANNEL1      /* Captured by software */
+
+int sample_ts_init(void)
+{
+    nrf_ppi_channel_t ch;
+    nrfx_err_t err;
+
+    nrf_timer_task_trigger(SAMPLE_TS_TIMER, NRF_TIMER_TASK_STOP);
+    nrf_timer_mode_set(SAMPLE_TS_TIMER, NRF_TIMER_MODE_TIMER);
+    nrf_timer_bit_width_set(SAMPLE_TS_TIMER, NRF_TIMER_BIT_WIDTH_32);
+    nrf_timer_frequency_set(SAMPLE_TS_TIMER, NRF_TIMER_FREQ_1MHz);
+    nrf_timer_task_trigger(SAMPLE_TS_TIMER, NRF_TIMER_TASK_CLEAR);
+    nrf_timer_task_trigger(SAMPLE_TS_TIMER, NRF_TIMER_TASK_START);
+
+    err = nrfx_ppi_channel_alloc(&ch);
+    if (err != NRFX_SUCCESS) {
+        printk("sample_ts: no PPI channel available\n\r");
+        return -EBUSY;
+    }
+
+    nrfx_ppi_channel_assign(ch,
+        nrf_saadc_event_address_get(NRF_SAADC, NRF_SAADC_EVENT_END),
+        nrf_timer_task_address_get(SAMPLE_TS_TIMER,
+            nrf_timer_capture_task_get(SAMPLE_TS_CC_SAMPLE)));
+    nrfx_ppi_channel_enable(ch);
+
+    return 0;
+}
+
+uint32_t sample_ts_get(void)
+{
+    return nrf_timer_cc_get(SAMPLE_TS_TIMER, SAMPLE_TS_CC_SAMPLE);
+}
+
+uint32_t sample_ts_now(void)
+{
+    /* Threads at different priorities may capture concurrently */
+    unsigned int key = irq_lock();
+    uint32_t now;
+
+    nrf_timer_task_trigger(SAMPLE_TS_TIMER,
+        nrf_timer_capture_task_get(SAMPLE_TS_CC_NOW));
+    now = nrf_timer_cc_get(SAMPLE_TS_TIMER, SAMPLE_TS_CC_NOW);
+    irq_unlock(key);
+
+    return now;
+}
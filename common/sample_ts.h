@@ -0,0 +1,59 @@
+/*
+ * Sample timestamps
+ *
+ * With APP_SAMPLE_TS_HW (nRF52 SAADC), TIMER2 runs free at 1 MHz and a
+ * PPI channel captures it into CC[0] on every SAADC END event, so each
+ * sample is stamped at the end of its conversion, independent of when
+ * thread_ADC_code gets to run. Elsewhere (native_posix, other ADCs) the
+ * stamp is taken from k_cycle_get_32() right after adc_read() returns.
+ *
+ * Stamps are in timer units and wrap; only differences are meaningful,
+ * converted with sample_ts_delta_us().
+ */
+
+#ifndef SAMPLE_TS_H
+#define SAMPLE_TS_H
+
+#include <zephyr.h>
+
+#ifdef CONFIG_APP_SAMPLE_TS_HW
+
+/* Starts TIMER2 and connects SAADC END to its capture task */
+int sample_ts_init(void);
+
+/* Instant of the last SAADC END event */
+uint32_t sample_ts_get(void);
+
+/* Current instant, in the same time base */
+uint32_t sample_ts_now(void);
+
+static inline uint32_t sample_ts_delta_us(uint32_t from, uint32_t to)
+{
+    return to - from;
+}
+
+#else
+
+static inline int sample_ts_init(void)
+{
+    return 0;
+}
+
+static inline uint32_t sample_ts_now(void)
+{
+    return k_cycle_get_32();
+}
+
+static inline uint32_t sample_ts_get(void)
+{
+    return sample_ts_now();
+}
+
+static inline uint32_t sample_ts_delta_us(uint32_t from, uint32_t to)
+{
+    return k_cyc_to_us_floor32(to - from);
+}
+
+#endif /* CONFIG_APP_SAMPLE_TS_HW */
+
+#endif /* SAMPLE_TS_H */
@@ -0,0 +1,217 @@
+/*
+ * Scheduling profiles of the pipeline threads
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <shell/shell.h>
+#include <string.h>
+
+#include "sched_profile.h"
+#include "pipeline_cfg.h"
+#include "latency_hist.h"
+
+/* Priority of every stage in the legacy profile */
+#define SCHED_LEGACY_PRIO 1
+
+static const char *const profile_names[SCHED_PROFILE_COUNT] = {
+    [SCHED_PROFILE_LEGACY] = "legacy",
+    [SCHED_PROFILE_DM] = "dm",
+};
+
+static const char *const stage_names[SCHED_STAGE_COUNT] = {
+    [SCHED_STAGE_ADC] = "ADC",
+    [SCHED_STAGE_FILTRO] = "FILTRO",
+    [SCHED_STAGE_PWM] = "PWM",
+};
+
+static k_tid_t stage_tid[SCHED_STAGE_COUNT];
+static enum sched_profile active = SCHED_PROFILE_LEGACY;
+
+/* Worst ADC release jitter seen under each profile (us) */
+static int32_t worst_jitter_us[SCHED_PROFILE_COUNT];
+static uint32_t jitter_samples[SCHED_PROFILE_COUNT];
+
+void sched_profile_register(enum sched_stage stage, k_tid_t tid)
+{
+    stage_tid[stage] = tid;
+}
+
+enum sched_profile sched_profile_default(void)
+{
+    return IS_ENABLED(CONFIG_APP_SCHED_BOOT_DM) ? SCHED_PROFILE_DM : SCHED_PROFILE_LEGACY;
+}
+
+/* Relative deadline of each stage (us) */
+static uint32_t stage_deadline_us(enum sched_stage stage)
+{
+    struct pipeline_cfg cfg;
+    uint32_t period_us;
+
+    pipeline_cfg_get(&cfg);
+    period_us = cfg.adc_period_ms * 1000U;
+
+    switch (stage) {
+    case SCHED_STAGE_ADC:
+        return CONFIG_APP_SCHED_ADC_DEADLINE_US;
+    case SCHED_STAGE_FILTRO:
+        return period_us / 2;
+    default:
+        return period_us;
+    }
+}
+
+/* Shortest deadline first; the first stage runs cooperative */
+static void sched_dm_priorities(int prio[SCHED_STAGE_COUNT])
+{
+    int order[SCHED_STAGE_COUNT];
+
+    for (int i = 0; i < SCHED_STAGE_COUNT; i++) {
+        int j = i;
+
+        /* Insertion sort, ties keep pipeline order */
+        while (j > 0 && stage_deadline_us(order[j - 1]) > stage_deadline_us(i)) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    prio[order[0]] = K_PRIO_COOP(CONFIG_NUM_COOP_PRIORITIES - 1);
+    for (int rank = 1; rank < SCHED_STAGE_COUNT; rank++) {
+        prio[order[rank]] = K_PRIO_PREEMPT(rank);
+    }
+}
+
+/* Closes the jitter record of the active profile */
+static void sched_jitter_snapshot(void)
+{
+#ifdef CONFIG_APP_LATENCY_HIST
+    if (hist_adc_jitter.count) {
+        worst_jitter_us[active] = MAX(worst_jitter_us[active], hist_adc_jitter.max);
+        jitter_samples[active] += hist_adc_jitter.count;
+    }
+    histogram_reset(&hist_adc_jitter);
+#endif
+}
+
+int sched_profile_apply(enum sched_profile profile)
+{
+    int prio[SCHED_STAGE_COUNT];
+
+    if (profile >= SCHED_PROFILE_COUNT) {
+        return -EINVAL;
+    }
+
+    if (profile == SCHED_PROFILE_DM) {
+        sched_dm_priorities(prio);
+    } else {
+        for (int i = 0; i < SCHED_STAGE_COUNT; i++) {
+            prio[i] = SCHED_LEGACY_PRIO;
+        }
+    }
+
+    sched_jitter_snapshot();
+    active = profile;
+
+    /* Downstream stages first, so a raised ADC does not run on a half-set table */
+    for (int i = SCHED_STAGE_COUNT - 1; i >= 0; i--) {
+        if (stage_tid[i]) {
+            k_thread_priority_set(stage_tid[i], prio[i]);
+        }
+    }
+
+#ifdef CONFIG_TIMESLICING
+    if (profile == SCHED_PROFILE_DM) {
+        k_sched_time_slice_set(0, 0);
+    } else {
+        k_sched_time_slice_set(CONFIG_TIMESLICE_SIZE, CONFIG_TIMESLICE_PRIORITY);
+    }
+#endif
+
+    printk("Scheduling profile %s applied\n\r", profile_names[profile]);
+    return 0;
+}
+
+/* Worst jitter of 'profile' including what the live histogram holds */
+static int32_t sched_worst_jitter(enum sched_profile profile, uint32_t *samples)
+{
+    int32_t worst = worst_jitter_us[profile];
+
+    *samples = jitter_samples[profile];
+#ifdef CONFIG_APP_LATENCY_HIST
+    if (profile == active && hist_adc_jitter.count) {
+        worst = MAX(worst, hist_adc_jitter.max);
+        *samples += hist_adc_jitter.count;
+    }
+#endif
+    return worst;
+}
+
+void sched_profile_print(void)
+{
+    uint32_t samples;
+    int32_t worst;
+
+    printk("profile %s, timeslicing %s\n\r", profile_names[active],
+        IS_ENABLED(CONFIG_TIMESLICING) && active == SCHED_PROFILE_LEGACY ? "on" : "off");
+    for (int i = 0; i < SCHED_STAGE_COUNT; i++) {
+        if (stage_tid[i]) {
+            printk("  %-7s prio %3d, deadline %u us\n\r", stage_names[i],
+                k_thread_priority_get(stage_tid[i]), stage_deadline_us(i));
+        }
+    }
+    for (int p = 0; p < SCHED_PROFILE_COUNT; p++) {
+        worst = sched_worst_jitter(p, &samples);
+        printk("  worst ADC release jitter (%s): %d us over %u releases\n\r",
+            profile_names[p], worst, samples);
+    }
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_sched_show(const struct shell *sh, size_t argc, char **argv)
+{
+    uint32_t samples;
+    int32_t worst;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    shell_print(sh, "profile %s, timeslicing %s", profile_names[active],
+        IS_ENABLED(CONFIG_TIMESLICING) && active == SCHED_PROFILE_LEGACY ? "on" : "off");
+    for (int i = 0; i < SCHED_STAGE_COUNT; i++) {
+        if (stage_tid[i]) {
+            shell_print(sh, "  %-7s prio %3d, deadline %u us", stage_names[i],
+                k_thread_priority_get(stage_tid[i]), stage_deadline_us(i));
+        }
+    }
+    for (int p = 0; p < SCHED_PROFILE_COUNT; p++) {
+        worst = sched_worst_jitter(p, &samples);
+        shell_print(sh, "  worst ADC release jitter (%s): %d us over %u releases",
+            profile_names[p], worst, samples);
+    }
+    return 0;
+}
+
+static int cmd_sched_profile(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+
+    for (int p = 0; p < SCHED_PROFILE_COUNT; p++) {
+        if (strcmp(argv[1], profile_names[p]) == 0) {
+            return sched_profile_apply(p);
+        }
+    }
+
+    shell_error(sh, "unknown profile %s (legacy|dm)", argv[1]);
+    return -EINVAL;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_sched,
+    SHELL_CMD(show, NULL, "Print priorities and worst release jitter per profile", cmd_sched_show),
+    SHELL_CMD_ARG(profile, NULL, "Switch profile: <legacy|dm>", cmd_sched_profile, 2, 0),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(sched, &sub_sched, "Scheduling profile of the pipeline threads", NULL);
+#endif /* CONFIG_SHELL */
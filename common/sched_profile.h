@@ -0,0 +1,74 @@
+/*
+ * Scheduling profiles of the pipeline threads
+ *
+ *  - SCHED_PROFILE_LEGACY: every stage at preemptible priority 1, kernel
+ *    timeslicing as configured (the original setup)
+ *  - SCHED_PROFILE_DM: deadline-monotonic priorities. All stages share
+ *    the sampling period, so the order follows their deadlines: ADC must
+ *    start within CONFIG_APP_SCHED_ADC_DEADLINE_US of its release,
+ *    FILTRO within half a period and PWM within the period. The stage
+ *    with the shortest deadline (ADC) runs cooperative, the others
+ *    preemptible below it, and timeslicing is turned off.
+ *
+ * The profile is applied at boot (legacy unless CONFIG_APP_SCHED_BOOT_DM)
+ * and can be switched at run time with the "sched" shell command; the
+ * worst ADC release jitter seen under each profile is kept for comparison
+ * (needs CONFIG_APP_LATENCY_HIST).
+ */
+
+#ifndef SCHED_PROFILE_H
+#define SCHED_PROFILE_H
+
+#include <zephyr.h>
+
+enum sched_profile {
+    SCHED_PROFILE_LEGACY,
+    SCHED_PROFILE_DM,
+    SCHED_PROFILE_COUNT,
+};
+
+enum sched_stage {
+    SCHED_STAGE_ADC,
+    SCHED_STAGE_FILTRO,
+    SCHED_STAGE_PWM,
+    SCHED_STAGE_COUNT,
+};
+
+#ifdef CONFIG_APP_SCHED_PROFILE
+
+/* Hands a pipeline thread over to the profile */
+void sched_profile_register(enum sched_stage stage, k_tid_t tid);
+
+/* Sets priorities and timeslicing of the registered threads */
+int sched_profile_apply(enum sched_profile profile);
+
+/* Profile selected in Kconfig, applied at boot */
+enum sched_profile sched_profile_default(void);
+
+/* Prints profile, priorities and worst release jitter per profile */
+void sched_profile_print(void);
+
+#else
+
+static inline void sched_profile_register(enum sched_stage stage, k_tid_t tid)
+{
+    ARG_UNUSED(stage);
+    ARG_UNUSED(tid);
+}
+
+static inline int sched_profile_apply(enum sched_profile profile)
+{
+    ARG_UNUSED(profile);
+    return 0;
+}
+
+static inline enum sched_profile sched_profile_default(void)
+{
+    return SCHED_PROFILE_LEGACY;
+}
+
+static inline void sched_profile_print(void) {}
+
+#endif /* CONFIG_APP_SCHED_PROFILE */
+
+#endif /* SCHED_PROFILE_H */
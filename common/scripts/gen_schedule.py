@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+"""Generates the cyclic executive schedule table.
+
+Reads a schedule description (see common/cyclic_schedule.txt) and writes a
+C header with the minor frame length, the number of minor frames in the
+major frame, the ADC step period, the steps of each frame and the budget
+of each step:
+
+    gen_schedule.py cyclic_schedule.txt cyclic_schedule.h
+
+Fails if the budgets of the steps of any frame exceed the minor frame.
+"""
+
+import argparse
+import math
+import sys
+
+STEPS = ["adc", "filter", "pwm"]
+MAX_FRAMES = 256
+
+
+def parse(path):
+    minor_us = None
+    entries = []
+    with open(path) as f:
+        for lineno, line in enumerate(f, 1):
+            tok = line.split("#", 1)[0].split()
+            if not tok:
+                continue
+            where = "%s:%d" % (path, lineno)
+            if tok[0] == "minor_us" and len(tok) == 2:
+                minor_us = int(tok[1], 0)
+                continue
+            if len(tok) != 4 or tok[0] not in STEPS:
+                sys.exit("%s: expected '<%s> <period> <offset> <budget_us>'"
+                         % (where, "|".join(STEPS)))
+            name, period, offset, budget = tok[0], *(int(t, 0) for t in tok[1:])
+            if period < 1 or not 0 <= offset < period or budget < 0:
+                sys.exit("%s: need period >= 1, 0 <= offset < period, budget >= 0" % where)
+            if any(e[0] == name for e in entries):
+                sys.exit("%s: step %s listed twice" % (where, name))
+            entries.append((name, period, offset, budget))
+    if not minor_us or minor_us < 1:
+        sys.exit("%s: missing 'minor_us'" % path)
+    if not entries:
+        sys.exit("%s: no steps" % path)
+    return minor_us, entries
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("schedule", help="schedule description")
+    parser.add_argument("output", help="generated header")
+    args = parser.parse_args()
+
+    minor_us, entries = parse(args.schedule)
+    n_frames = 1
+    for _, period, _, _ in entries:
+        n_frames = n_frames * period // math.gcd(n_frames, period)
+    if n_frames > MAX_FRAMES:
+        sys.exit("%s: major frame of %d minor frames, at most %d"
+                 % (args.schedule, n_frames, MAX_FRAMES))
+
+    frames = []
+    for f in range(n_frames):
+        slots = [e for e in entries if f % e[1] == e[2]]
+        load = sum(e[3] for e in slots)
+        if load > minor_us:
+            sys.exit("%s: frame %d needs %d us (%s), minor frame is %d us"
+                     % (args.schedule, f, load, " ".join(e[0] for e in slots), minor_us))
+        frames.append(slots)
+    n_slots = max(len(s) for s in frames)
+    budgets = {e[0]: e[3] for e in entries}
+    periods = {e[0]: e[1] for e in entries}
+
+    out = []
+    out.append("/* Generated by gen_schedule.py from %s, do not edit */" % args.schedule)
+    out.append("")
+    out.append("#define CYCLIC_MINOR_US %d" % minor_us)
+    out.append("#define CYCLIC_N_FRAMES %d" % n_frames)
+    out.append("#define CYCLIC_N_SLOTS %d" % max(n_slots, 1))
+    out.append("#define CYCLIC_SLOT_NONE 0xff")
+    out.append("#define CYCLIC_ADC_PERIOD_US %d" % (periods.get("adc", 0) * minor_us))
+    out.append("")
+    out.append("static const uint8_t cyclic_table[CYCLIC_N_FRAMES][CYCLIC_N_SLOTS] = {")
+    for f, slots in enumerate(frames):
+        ids = ["CYCLIC_STEP_%s" % e[0].upper() for e in slots]
+        ids += ["CYCLIC_SLOT_NONE"] * (max(n_slots, 1) - len(ids))
+        out.append("    { %s },  /* frame %d: %d us */"
+                   % (", ".join(ids), f, sum(e[3] for e in slots)))
+    out.append("};")
+    out.append("")
+    out.append("static const uint32_t cyclic_budget_us[CYCLIC_STEP_COUNT] = {")
+    for name in STEPS:
+        out.append("    [CYCLIC_STEP_%s] = %d," % (name.upper(), budgets.get(name, 0)))
+    out.append("};")
+
+    with open(args.output, "w") as f:
+        f.write("\n".join(out) + "\n")
+
+    worst = max(sum(e[3] for e in s) for s in frames)
+    print("cyclic schedule: %d x %d us frames, worst frame budget %d us (%d%%)"
+          % (n_frames, minor_us, worst, 100 * worst // minor_us))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+"""Builds a replay trace image for the "storage" flash partition.
+
+Reads raw ADC values (one per line, as used by the native_posix replay) and
+writes an Intel HEX file with the layout expected by common/replay.c:
+uint32 magic, uint32 count, then count little-endian uint16 samples.
+
+    replay_image.py trace.txt trace.hex [--base 0xf8000]
+    nrfjprog --program trace.hex --sectorerase
+"""
+
+import argparse
+import struct
+
+MAGIC = 0x59504C52
+
+
+def ihex_record(rtype, addr, data):
+    rec = bytes([len(data), (addr >> 8) & 0xFF, addr & 0xFF, rtype]) + data
+    return ":" + (rec + bytes([(-sum(rec)) & 0xFF])).hex().upper()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("trace", help="text trace, one raw value per line")
+    parser.add_argument("output", help="Intel HEX output")
+    parser.add_argument("--base", type=lambda s: int(s, 0), default=0xF8000,
+                        help="storage partition address (default 0xf8000)")
+    args = parser.parse_args()
+
+    with open(args.trace) as f:
+        samples = [int(tok) for tok in f.read().split()]
+
+    blob = struct.pack("<II", MAGIC, len(samples))
+    blob += struct.pack("<%dH" % len(samples), *samples)
+
+    lines = []
+    upper = None
+    for off in range(0, len(blob), 16):
+        addr = args.base + off
+        if addr >> 16 != upper:
+            upper = addr >> 16
+            lines.append(ihex_record(4, 0, struct.pack(">H", upper)))
+        lines.append(ihex_record(0, addr & 0xFFFF, blob[off:off + 16]))
+    lines.append(ihex_record(1, 0, b""))
+
+    with open(args.output, "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+if __name__ == "__main__":
+    main()
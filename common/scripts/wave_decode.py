@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+"""Decodes a "whist export" capture into CSV.
+
+Reads a console log containing the lines printed by "whist export"
+(common/wave_hist.c) and writes one CSV row per sample:
+
+    wave_decode.py console.log > wave.csv
+    stream,t_ms,mv
+    in,120530,1512
+    ...
+
+Chunk layout and encoding are described in common/wavecomp.h.
+"""
+
+import argparse
+import csv
+import sys
+
+
+def unzigzag(z):
+    return (z >> 1) ^ -(z & 1)
+
+
+def decode_chunk(t0, period, first, count, data):
+    value = first
+    yield t0, value
+    pos = 0
+    for i in range(1, count):
+        z = shift = 0
+        while True:
+            if pos >= len(data):
+                raise ValueError("chunk at %d ms truncated after %d samples" % (t0, i))
+            b = data[pos]
+            pos += 1
+            z |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                break
+        value = (value + unzigzag(z)) & 0xFFFF
+        yield t0 + i * period, value
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", nargs="?", type=argparse.FileType("r"), default=sys.stdin,
+                        help="console capture (default: stdin)")
+    parser.add_argument("--stream", help="only this stream (in, out)")
+    args = parser.parse_args()
+
+    out = csv.writer(sys.stdout, lineterminator="\n")
+    out.writerow(["stream", "t_ms", "mv"])
+    chunks = 0
+    for line in args.log:
+        fields = line.split()
+        # Shell prompts or escape codes may precede the record
+        if "W" not in fields:
+            continue
+        fields = fields[fields.index("W") + 1:]
+        if len(fields) not in (5, 6):
+            continue
+        stream, t0, period, first, count = fields[0], *(int(f) for f in fields[1:5])
+        if args.stream and stream != args.stream:
+            continue
+        data = bytes.fromhex(fields[5]) if len(fields) == 6 else b""
+        for t, v in decode_chunk(t0, period, first, count, data):
+            out.writerow([stream, t, v])
+        chunks += 1
+    print("%d chunks decoded" % chunks, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,15 @@
+/*
+ * Sequence number checker
+ */
+
+#include "seq_check.h"
+
+void seq_check_reset(struct seq_check *c)
+{
+    c->started = false;
+    c->expected = 0;
+    c->received = 0;
+    c->gaps = 0;
+    c->lost = 0;
+    c->reordered = 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * Sequence number checker
+ *
+ * Every sample gets a sequence number at acquisition, incremented by one
+ * per sample. A consumer feeds the numbers it receives to a seq_check,
+ * which counts:
+ *  - gaps: arrivals that skipped one or more numbers
+ *  - lost: numbers skipped so far, minus those that arrived late
+ *  - reordered: arrivals older than the last one seen
+ * Single writer (the consuming thread). Plain C, no kernel dependencies.
+ */
+
+#ifndef SEQ_CHECK_H
+#define SEQ_CHECK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct seq_check {
+    bool started;
+    uint32_t expected;          /* next number expected in order */
+    uint32_t received;
+    uint32_t gaps;
+    uint32_t lost;
+    uint32_t reordered;
+};
+
+/* Clears the counters; the next number received restarts the sequence */
+void seq_check_reset(struct seq_check *c);
+
+/* Accounts for 'seq'; returns how many numbers it skipped (0 if in order) */
+static inline uint32_t seq_check_update(struct seq_check *c, uint32_t seq)
+{
+    int32_t skip = (int32_t)(seq - c->expected);
+
+    c->received++;
+
+    if (!c->started || skip == 0) {
+        c->started = true;
+        c->expected = seq + 1;
+        return 0;
+    }
+
+    if (skip < 0) {
+        /* Late arrival of a number already counted as lost */
+        c->reordered++;
+        if (c->lost) {
+            c->lost--;
+        }
+        return 0;
+    }
+
+    c->gaps++;
+    c->lost += (uint32_t)skip;
+    c->expected = seq + 1;
+    return (uint32_t)skip;
+}
+
+#endif /* SEQ_CHECK_H */
@@ -0,0 +1,207 @@
+/*
+ * Spectral analysis of the acquired signal
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <shell/shell.h>
+#include <arm_math.h>
+
+#include "spectrum.h"
+#include "pipeline_cfg.h"
+
+#define FFT_LEN CONFIG_APP_SPECTRUM_FFT_LEN
+#define N_BINS (FFT_LEN / 2)
+#define N_BANDS CONFIG_APP_SPECTRUM_BANDS
+
+BUILD_ASSERT(N_BANDS <= N_BINS - 1, "more bands than non-DC bins");
+
+/* Capture handshake with thread_ADC_code */
+enum {
+    SPECTRUM_IDLE,
+    SPECTRUM_CAPTURE,
+    SPECTRUM_READY,
+};
+
+static atomic_t state = ATOMIC_INIT(SPECTRUM_IDLE);
+static uint16_t block[FFT_LEN];
+static uint32_t block_len;
+static uint32_t block_period_ms;        /* sampling period of block[] */
+static K_SEM_DEFINE(block_ready, 0, 1);
+
+static q15_t window[FFT_LEN];
+static q15_t fft_in[FFT_LEN];
+static q15_t fft_out[2 * FFT_LEN];
+static q15_t mag[N_BINS];
+static arm_rfft_instance_q15 rfft;
+
+static struct k_spinlock lock;
+static struct spectrum_result latest;
+
+void spectrum_push(uint16_t sample)
+{
+    struct pipeline_cfg cfg;
+
+    if (atomic_get(&state) != SPECTRUM_CAPTURE) {
+        return;
+    }
+
+    /* A new period applies from this sample on: restart the block with it */
+    pipeline_cfg_get(&cfg);
+    if (cfg.adc_period_ms != block_period_ms) {
+        block_period_ms = cfg.adc_period_ms;
+        block_len = 0;
+    }
+
+    block[block_len++] = sample;
+    if (block_len == FFT_LEN) {
+        atomic_set(&state, SPECTRUM_READY);
+        k_sem_give(&block_ready);
+    }
+}
+
+int spectrum_get(struct spectrum_result *res)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    *res = latest;
+    k_spin_unlock(&lock, key);
+    return res->blocks ? 0 : -ENODATA;
+}
+
+/* Mean removed, scaled to Q15 (mV << 3, up to 3.6 V fits) and windowed */
+static void spectrum_prepare(void)
+{
+    uint32_t sum = 0;
+    int32_t mean;
+
+    for (int i = 0; i < FFT_LEN; i++) {
+        sum += block[i];
+    }
+    mean = (int32_t)(sum / FFT_LEN);
+
+    for (int i = 0; i < FFT_LEN; i++) {
+        int32_t x = ((int32_t)block[i] - mean) << 3;
+
+        x = CLAMP(x, INT16_MIN, INT16_MAX);
+        fft_in[i] = (q15_t)((x * window[i]) >> 15);
+    }
+}
+
+static void spectrum_analyze(uint32_t period_ms)
+{
+    struct spectrum_result res;
+    uint32_t total = 0, peak = 1;
+    uint32_t bins_per_band = (N_BINS - 1) / N_BANDS;
+    k_spinlock_key_t key;
+
+    spectrum_prepare();
+    arm_rfft_q15(&rfft, fft_in, fft_out);
+    arm_cmplx_mag_q15(fft_out, mag, N_BINS);
+
+    /* Bin 0 is DC (removed above); bins 1..N_BINS-1 go into the bands */
+    for (int k = 1; k < N_BINS; k++) {
+        total += mag[k];
+        if (mag[k] > mag[peak]) {
+            peak = k;
+        }
+    }
+
+    key = k_spin_lock(&lock);
+    res = latest;
+    k_spin_unlock(&lock, key);
+
+    res.blocks++;
+    res.fs_mhz = 1000000 / period_ms;
+    res.peak_mhz = peak * res.fs_mhz / FFT_LEN;
+    res.peak_permille = total ? mag[peak] * 1000 / total : 0;
+    for (int b = 0; b < N_BANDS; b++) {
+        uint32_t first = 1 + b * bins_per_band;
+        uint32_t last = b == N_BANDS - 1 ? N_BINS : first + bins_per_band;
+        uint32_t sum = 0;
+
+        for (uint32_t k = first; k < last; k++) {
+            sum += mag[k];
+        }
+        res.band[b] = total ? sum * 1000 / total : 0;
+    }
+
+    key = k_spin_lock(&lock);
+    latest = res;
+    k_spin_unlock(&lock, key);
+
+    printk("spectrum: fs %u.%03u Hz, peak %u.%03u Hz (%u permille)\n\r",
+        res.fs_mhz / 1000, res.fs_mhz % 1000,
+        res.peak_mhz / 1000, res.peak_mhz % 1000, res.peak_permille);
+}
+
+static void spectrum_thread(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    if (arm_rfft_init_q15(&rfft, FFT_LEN, 0, 1) != ARM_MATH_SUCCESS) {
+        printk("spectrum: FFT length %u not supported\n\r", FFT_LEN);
+        return;
+    }
+
+    /* Hann window: 0.5 - 0.5 cos(2 pi i / N), arm_cos_q15 takes [0, 1) for [0, 2 pi) */
+    for (int i = 0; i < FFT_LEN; i++) {
+        q15_t c = arm_cos_q15((q15_t)(i * 32768 / FFT_LEN));
+
+        window[i] = (q15_t)MIN(16384 - c / 2, INT16_MAX);
+    }
+
+    while (1) {
+        struct pipeline_cfg cfg;
+
+        k_msleep(CONFIG_APP_SPECTRUM_PERIOD_MS);
+
+        pipeline_cfg_get(&cfg);
+        block_period_ms = cfg.adc_period_ms;
+        block_len = 0;
+        atomic_set(&state, SPECTRUM_CAPTURE);
+        k_sem_take(&block_ready, K_FOREVER);
+
+        spectrum_analyze(block_period_ms);
+        atomic_set(&state, SPECTRUM_IDLE);
+    }
+}
+
+K_THREAD_DEFINE(spectrum_tid, CONFIG_APP_SPECTRUM_STACK_SIZE, spectrum_thread, NULL, NULL, NULL,
+                K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+
+#ifdef CONFIG_SHELL
+static int cmd_spectrum(const struct shell *sh, size_t argc, char **argv)
+{
+    struct spectrum_result res;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    if (spectrum_get(&res)) {
+        shell_print(sh, "no analysis yet (one every %u ms, %u samples)",
+            CONFIG_APP_SPECTRUM_PERIOD_MS, FFT_LEN);
+        return 0;
+    }
+
+    shell_print(sh, "%u blocks of %u samples at %u.%03u Hz", res.blocks, FFT_LEN,
+        res.fs_mhz / 1000, res.fs_mhz % 1000);
+    shell_print(sh, "peak %u.%03u Hz, %u permille of the total", res.peak_mhz / 1000,
+        res.peak_mhz % 1000, res.peak_permille);
+
+    for (int b = 0; b < N_BANDS; b++) {
+        uint32_t first = 1 + b * ((N_BINS - 1) / N_BANDS);
+        uint32_t last = b == N_BANDS - 1 ? N_BINS : first + (N_BINS - 1) / N_BANDS;
+        uint32_t lo = first * res.fs_mhz / FFT_LEN;
+        uint32_t hi = last * res.fs_mhz / FFT_LEN;
+
+        shell_print(sh, "  %u.%03u - %u.%03u Hz: %u permille", lo / 1000, lo % 1000,
+            hi / 1000, hi % 1000, res.band[b]);
+    }
+    return 0;
+}
+
+SHELL_CMD_REGISTER(spectrum, NULL, "Spectrum of the acquired signal", cmd_spectrum);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,47 @@
+/*
+ * Spectral analysis of the acquired signal
+ *
+ * Every CONFIG_APP_SPECTRUM_PERIOD_MS a low-priority thread asks
+ * thread_ADC_code for a block of CONFIG_APP_SPECTRUM_FFT_LEN samples
+ * (spectrum_push() only stores the sample while a block is wanted, and
+ * never blocks). The block has its mean removed, is scaled to Q15, Hann
+ * windowed and transformed with arm_rfft_q15() (CMSIS-DSP). The result
+ * gives the dominant frequency and CONFIG_APP_SPECTRUM_BANDS equal-width
+ * band magnitudes in permille of the total (DC excluded), printed once
+ * per analysis and shown by the "spectrum" shell command.
+ *
+ * The sampling rate is taken from the active pipeline configuration and
+ * checked on every sample; a period change restarts the block.
+ */
+
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <zephyr.h>
+
+#ifdef CONFIG_APP_SPECTRUM
+
+struct spectrum_result {
+    uint32_t blocks;            /* analyses done so far */
+    uint32_t fs_mhz;            /* sampling rate (mHz) */
+    uint32_t peak_mhz;          /* dominant frequency (mHz) */
+    uint32_t peak_permille;     /* its share of the total magnitude */
+    uint16_t band[CONFIG_APP_SPECTRUM_BANDS];   /* permille per band */
+};
+
+/* Offers one acquired sample (mV) to the analysis; ADC thread only */
+void spectrum_push(uint16_t sample);
+
+/* Copies the latest result; returns -ENODATA before the first analysis */
+int spectrum_get(struct spectrum_result *res);
+
+#else
+
+static inline void spectrum_push(uint16_t sample)
+{
+    ARG_UNUSED(sample);
+}
+
+#endif /* CONFIG_APP_SPECTRUM */
+
+#endif /* SPECTRUM_H */
@@ -0,0 +1,119 @@
+/*
+ * Streaming statistics
+ */
+
+#include "stats.h"
+
+void stats_reset(struct stats_acc *s)
+{
+    s->count = 0;
+    s->min = 0;
+    s->max = 0;
+    s->mean_q32 = 0;
+    s->m2_q8 = 0;
+}
+
+void stats_add(struct stats_acc *s, uint16_t x)
+{
+    int64_t x_q32 = (int64_t)x << 32;
+    int64_t delta, delta2, step;
+
+    if (s->count == 0 || x < s->min) {
+        s->min = x;
+    }
+    if (s->count == 0 || x > s->max) {
+        s->max = x;
+    }
+    s->count++;
+
+    /* mean += (x - mean) / n, rounded to nearest */
+    delta = x_q32 - s->mean_q32;
+    step = (delta >= 0 ? delta + s->count / 2 : delta - s->count / 2) / (int64_t)s->count;
+    s->mean_q32 += step;
+
+    /* m2 += (x - old mean) * (x - new mean); both factors in Q16 */
+    delta2 = x_q32 - s->mean_q32;
+    step = ((delta >> 16) * (delta2 >> 16)) >> 24;
+    if (step > 0) {
+        s->m2_q8 += (uint64_t)step;
+    }
+}
+
+void stats_snapshot(const struct stats_acc *s, struct stats_snapshot *snap)
+{
+    snap->count = s->count;
+    snap->min = s->min;
+    snap->max = s->max;
+    snap->mean_q8 = (uint32_t)((s->mean_q32 + (1LL << 23)) >> 24);
+    snap->var_q8 = s->count ? (uint32_t)(s->m2_q8 / s->count) : 0;
+}
+
+static void mono_reset(struct stats_mono *q)
+{
+    q->head = 0;
+    q->len = 0;
+}
+
+/* Drops from the back the values that 'x' makes irrelevant, then adds x */
+static void mono_push(struct stats_mono *q, uint16_t x, int want_min)
+{
+    while (q->len) {
+        uint16_t back = q->v[(q->head + q->len - 1) % STATS_WINDOW_MAX];
+
+        if (want_min ? back <= x : back >= x) {
+            break;
+        }
+        q->len--;
+    }
+    q->v[(q->head + q->len) % STATS_WINDOW_MAX] = x;
+    q->len++;
+}
+
+/* The evicted value leaves the queue only if it is the front */
+static void mono_evict(struct stats_mono *q, uint16_t x)
+{
+    if (q->len && q->v[q->head] == x) {
+        q->head = (q->head + 1) % STATS_WINDOW_MAX;
+        q->len--;
+    }
+}
+
+void stats_window_reset(struct stats_window *w)
+{
+    w->count = 0;
+    w->sum = 0;
+    w->sumsq = 0;
+    mono_reset(&w->lo);
+    mono_reset(&w->hi);
+    w->lo.v[0] = 0;
+    w->hi.v[0] = 0;
+}
+
+void stats_window_add(struct stats_window *w, uint16_t x)
+{
+    w->count++;
+    w->sum += x;
+    w->sumsq += (uint32_t)x * x;
+    mono_push(&w->lo, x, 1);
+    mono_push(&w->hi, x, 0);
+}
+
+void stats_window_remove(struct stats_window *w, uint16_t x)
+{
+    w->count--;
+    w->sum -= x;
+    w->sumsq -= (uint32_t)x * x;
+    mono_evict(&w->lo, x);
+    mono_evict(&w->hi, x);
+}
+
+void stats_window_snapshot(const struct stats_window *w, struct stats_snapshot *snap)
+{
+    uint64_t n = w->count;
+
+    snap->count = w->count;
+    snap->min = w->count ? stats_window_min(w) : 0;
+    snap->max = w->count ? stats_window_max(w) : 0;
+    snap->mean_q8 = n ? (uint32_t)(((uint64_t)w->sum << 8) / n) : 0;
+    snap->var_q8 = n ? (uint32_t)(((n * w->sumsq - (uint64_t)w->sum * w->sum) << 8) / (n * n)) : 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * Streaming statistics: count, min, max, mean and variance
+ *
+ * Two scopes, both O(1) per sample (window min/max amortized):
+ *  - stats_acc, lifetime: Welford's update in fixed point. The mean is
+ *    kept in Q32 mV, so it keeps tracking after billions of samples, and
+ *    the sum of squared deviations in Q8 mV^2.
+ *  - stats_window, sliding window: the caller's ring evicts its oldest
+ *    sample with stats_window_remove(). Exact integer sum and sum of
+ *    squares (a fixed-point Welford removal would drift), plus monotonic
+ *    min/max queues.
+ * Snapshots give the mean and (population) variance in Q8.
+ * Single writer. Plain C, no kernel dependencies.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+#ifndef STATS_WINDOW_MAX
+#ifdef CONFIG_APP_FILTER_WINDOW_MAX
+#define STATS_WINDOW_MAX CONFIG_APP_FILTER_WINDOW_MAX
+#else
+#define STATS_WINDOW_MAX 32
+#endif
+#endif
+
+struct stats_snapshot {
+    uint32_t count;
+    uint16_t min;
+    uint16_t max;
+    uint32_t mean_q8;           /* mean, mV << 8 */
+    uint32_t var_q8;            /* variance, mV^2 << 8 */
+};
+
+struct stats_acc {
+    uint32_t count;
+    uint16_t min;
+    uint16_t max;
+    int64_t mean_q32;           /* running mean, mV << 32 */
+    uint64_t m2_q8;             /* sum of squared deviations, mV^2 << 8 */
+};
+
+/* Monotonic queue of window values; front is the extreme */
+struct stats_mono {
+    uint16_t v[STATS_WINDOW_MAX];
+    uint16_t head;
+    uint16_t len;
+};
+
+struct stats_window {
+    uint16_t count;
+    uint32_t sum;
+    uint64_t sumsq;
+    struct stats_mono lo;       /* non-decreasing: front is the minimum */
+    struct stats_mono hi;       /* non-increasing: front is the maximum */
+};
+
+void stats_reset(struct stats_acc *s);
+void stats_add(struct stats_acc *s, uint16_t x);
+void stats_snapshot(const struct stats_acc *s, struct stats_snapshot *snap);
+
+void stats_window_reset(struct stats_window *w);
+
+/* Adds the newest sample; at most STATS_WINDOW_MAX may be held */
+void stats_window_add(struct stats_window *w, uint16_t x);
+
+/* Removes the oldest sample, whose value is x */
+void stats_window_remove(struct stats_window *w, uint16_t x);
+
+void stats_window_snapshot(const struct stats_window *w, struct stats_snapshot *snap);
+
+static inline uint16_t stats_window_min(const struct stats_window *w)
+{
+    return w->lo.v[w->lo.head];
+}
+
+static inline uint16_t stats_window_max(const struct stats_window *w)
+{
+    return w->hi.v[w->hi.head];
+}
+
+#endif /* STATS_H */
@@ -0,0 +1,144 @@
+/*
+ * Throughput saturation test
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+
+#include "stress.h"
+#include "pipeline_cfg.h"
+#include "handoff.h"
+
+/* Time allowed for the pipeline to drain between steps */
+#define STRESS_DRAIN_MS 100
+
+struct stress_step {
+    uint32_t rate_hz;
+    uint32_t releases;
+    uint32_t overruns;
+    uint32_t deadline_misses;
+    uint32_t drops;
+    uint32_t errors;
+    uint32_t max_backlog;
+};
+
+static atomic_t n_emitted;
+static atomic_t n_done;
+static uint32_t discarded_base;
+
+static K_TIMER_DEFINE(stress_timer, NULL, NULL);
+
+void stress_note_done(void)
+{
+    atomic_inc(&n_done);
+}
+
+uint32_t stress_backlog(void)
+{
+    /* PWM may finish a sample before stress_run counted it as emitted */
+    atomic_val_t backlog = atomic_get(&n_emitted) - atomic_get(&n_done) -
+        (atomic_val_t)(handoff_discarded() - discarded_base);
+
+    return backlog > 0 ? (uint32_t)backlog : 0;
+}
+
+/* 1, 2, 5, 10, 20, 50 ... */
+static uint32_t stress_next_rate(uint32_t rate)
+{
+    uint32_t decade = 1;
+
+    while (rate >= decade * 10) {
+        decade *= 10;
+    }
+    return rate == 2 * decade ? 5 * decade : 2 * rate;
+}
+
+static bool stress_step_ok(const struct stress_step *s)
+{
+    return !s->overruns && !s->deadline_misses && !s->drops && !s->errors;
+}
+
+static void stress_run_step(struct stress_step *s, stress_sample_fn sample)
+{
+    uint32_t period_us = 1000000U / s->rate_hz;
+    uint32_t releases = MAX(CONFIG_APP_STRESS_STEP_MS * s->rate_hz / 1000U, 3U);
+    uint32_t discarded = handoff_discarded();
+    uint32_t backlog;
+    int rc;
+
+    k_timer_start(&stress_timer, K_USEC(period_us), K_USEC(period_us));
+
+    while (s->releases < releases) {
+        uint32_t expired = k_timer_status_sync(&stress_timer);
+
+        if (expired > 1) {
+            s->overruns += expired - 1;
+        }
+
+        backlog = stress_backlog();
+        if (backlog) {
+            s->deadline_misses++;
+        }
+        s->max_backlog = MAX(s->max_backlog, backlog);
+
+        rc = sample();
+        if (rc == 0) {
+            atomic_inc(&n_emitted);
+        } else if (rc == -EBUSY) {
+            s->drops++;
+        } else {
+            s->errors++;
+        }
+        s->releases++;
+    }
+
+    k_timer_stop(&stress_timer);
+    s->drops += handoff_discarded() - discarded;
+
+    /* Let the pipeline drain before the next step */
+    for (int i = 0; i < STRESS_DRAIN_MS && stress_backlog(); i++) {
+        k_msleep(1);
+    }
+}
+
+void stress_run(const char *name, stress_sample_fn sample)
+{
+    struct stress_step s;
+    struct pipeline_cfg cfg;
+    uint32_t sustainable = 0, first_failing = 0, failing_steps = 0;
+
+    discarded_base = handoff_discarded();
+    pipeline_cfg_get(&cfg);
+
+    printk("\n\rstress: %s, filter window %u, %s source\n\r", name,
+        cfg.filter_window,
+        IS_ENABLED(CONFIG_APP_STRESS_SYNTHETIC) ? "synthetic" : "ADC");
+    handoff_print(NULL);
+    printk("%8s %8s %8s %8s %8s %8s %8s\n\r", "rate Hz", "releases", "overrun",
+        "missed", "dropped", "errors", "backlog");
+
+    for (uint32_t rate = 1; rate <= CONFIG_APP_STRESS_MAX_HZ; rate = stress_next_rate(rate)) {
+        s = (struct stress_step){ .rate_hz = rate };
+        stress_run_step(&s, sample);
+
+        printk("%8u %8u %8u %8u %8u %8u %8u\n\r", s.rate_hz, s.releases, s.overruns,
+            s.deadline_misses, s.drops, s.errors, s.max_backlog);
+
+        if (stress_step_ok(&s)) {
+            if (failing_steps == 0) {
+                sustainable = rate;
+            }
+        } else {
+            if (failing_steps == 0) {
+                first_failing = rate;
+            }
+            if (++failing_steps >= CONFIG_APP_STRESS_FAIL_STEPS) {
+                break;
+            }
+        }
+    }
+
+    printk("stress: %s sustainable rate %u Hz, first failing rate %u Hz\n\r",
+        name, sustainable, first_failing);
+    handoff_print(NULL);
+}
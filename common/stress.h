@@ -0,0 +1,53 @@
+/*
+ * Throughput saturation test
+ *
+ * Replaces the periodic loop of thread_ADC_code by a sweep of acquisition
+ * rates (1, 2, 5, 10, 20, 50 ... Hz). At each rate the pipeline runs for
+ * CONFIG_APP_STRESS_STEP_MS and the following is counted:
+ *  - overruns: timer releases the ADC thread could not keep up with
+ *  - deadline misses: releases that found earlier samples still in the
+ *    pipeline (PWM not done yet)
+ *  - drops: samples discarded by the hand-off overload policy (handoff.h)
+ *  - max backlog: samples in flight between ADC and PWM
+ * The highest rate with none of these is reported as the sustainable
+ * rate of the configuration.
+ */
+
+#ifndef STRESS_H
+#define STRESS_H
+
+#include <zephyr.h>
+
+/* Acquires one sample and hands it downstream; -EBUSY if it was dropped */
+typedef int (*stress_sample_fn)(void);
+
+static inline bool stress_enabled(void)
+{
+    return IS_ENABLED(CONFIG_APP_STRESS);
+}
+
+#ifdef CONFIG_APP_STRESS
+
+/* Runs the sweep and prints the capacity report; 'name' tags the report */
+void stress_run(const char *name, stress_sample_fn sample);
+
+/* Called by the last stage (PWM) when a sample left the pipeline */
+void stress_note_done(void);
+
+/* Samples handed to FILTRO and not yet done by PWM */
+uint32_t stress_backlog(void);
+
+#else
+
+static inline void stress_run(const char *name, stress_sample_fn sample)
+{
+    ARG_UNUSED(name);
+    ARG_UNUSED(sample);
+}
+
+static inline void stress_note_done(void) {}
+static inline uint32_t stress_backlog(void) { return 0; }
+
+#endif /* CONFIG_APP_STRESS */
+
+#endif /* STRESS_H */
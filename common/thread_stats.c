@@ -0,0 +1,169 @@
+/*
+ * Per-thread runtime statistics
+ *
+ * Utilisation is the share of the elapsed time (since boot or the last
+ * reset) that a thread spent running. Stack usage is the high-water mark
+ * found by CONFIG_INIT_STACKS, i.e. the deepest the stack was ever used.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <shell/shell.h>
+
+#include "thread_stats.h"
+#include "app_print.h"
+
+struct thread_stats_entry {
+    k_tid_t tid;
+    const char *name;
+    uint64_t base_cycles;       /* execution cycles at the last reset */
+    uint32_t switches;          /* times switched in (hook) */
+    uint32_t base_switches;
+};
+
+struct thread_stats_snapshot {
+    const char *name;
+    uint64_t cycles;            /* execution cycles in the window */
+    uint32_t cpu_x100;          /* utilisation in 1/100 % */
+    uint32_t switches;
+    size_t stack_used;
+    size_t stack_size;
+};
+
+static struct thread_stats_entry entries[CONFIG_APP_THREAD_STATS_MAX];
+static int n_entries;
+static int64_t base_ticks;
+
+int thread_stats_register(k_tid_t tid, const char *name)
+{
+    if (n_entries >= CONFIG_APP_THREAD_STATS_MAX) {
+        printk("thread_stats_register(): table full, %s not tracked\n\r", name);
+        return -ENOMEM;
+    }
+
+    k_thread_name_set(tid, name);
+
+    entries[n_entries].tid = tid;
+    entries[n_entries].name = name;
+    n_entries++;
+
+    return 0;
+}
+
+void thread_stats_reset(void)
+{
+    k_thread_runtime_stats_t rt;
+
+    for (int i = 0; i < n_entries; i++) {
+        if (k_thread_runtime_stats_get(entries[i].tid, &rt) == 0) {
+            entries[i].base_cycles = rt.execution_cycles;
+        }
+        entries[i].base_switches = entries[i].switches;
+    }
+    base_ticks = k_uptime_ticks();
+}
+
+static void thread_stats_collect(int i, struct thread_stats_snapshot *s)
+{
+    const struct thread_stats_entry *e = &entries[i];
+    k_thread_runtime_stats_t rt = { 0 };
+    uint64_t elapsed;
+    size_t unused = 0;
+
+    k_thread_runtime_stats_get(e->tid, &rt);
+    elapsed = k_ticks_to_cyc_floor64(k_uptime_ticks() - base_ticks);
+
+    s->name = e->name;
+    s->cycles = rt.execution_cycles - e->base_cycles;
+    s->cpu_x100 = elapsed ? (uint32_t)((s->cycles * 10000U) / elapsed) : 0;
+    s->switches = e->switches - e->base_switches;
+
+    s->stack_size = e->tid->stack_info.size;
+    if (k_thread_stack_space_get(e->tid, &unused) == 0) {
+        s->stack_used = s->stack_size - unused;
+    } else {
+        s->stack_used = 0;
+    }
+}
+
+void thread_stats_print(const struct shell *sh)
+{
+    struct thread_stats_snapshot s;
+
+    app_print(sh, "%-8s %12s %8s %8s %12s", "thread", "cycles", "cpu %", "switches", "stack");
+    for (int i = 0; i < n_entries; i++) {
+        thread_stats_collect(i, &s);
+        app_print(sh, "%-8s %12llu %5u.%02u %8u %5u / %5u", s.name, s.cycles,
+            s.cpu_x100 / 100, s.cpu_x100 % 100, s.switches,
+            (unsigned int)s.stack_used, (unsigned int)s.stack_size);
+    }
+}
+
+#ifdef CONFIG_APP_THREAD_STATS_SWITCHES
+/* Called by the kernel (CONFIG_TRACING_USER) on every context switch */
+void sys_trace_thread_switched_in_user(struct k_thread *thread)
+{
+    for (int i = 0; i < n_entries; i++) {
+        if (entries[i].tid == thread) {
+            entries[i].switches++;
+            break;
+        }
+    }
+}
+#endif
+
+#if CONFIG_APP_THREAD_STATS_PERIOD_MS > 0
+static void thread_stats_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(thread_stats_work, thread_stats_work_handler);
+
+static void thread_stats_work_handler(struct k_work *work)
+{
+    thread_stats_print(NULL);
+    k_work_reschedule(&thread_stats_work, K_MSEC(CONFIG_APP_THREAD_STATS_PERIOD_MS));
+}
+#endif
+
+static int thread_stats_init(const struct device *dev)
+{
+    ARG_UNUSED(dev);
+
+    base_ticks = k_uptime_ticks();
+#if CONFIG_APP_THREAD_STATS_PERIOD_MS > 0
+    k_work_reschedule(&thread_stats_work, K_MSEC(CONFIG_APP_THREAD_STATS_PERIOD_MS));
+#endif
+    return 0;
+}
+
+SYS_INIT(thread_stats_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#ifdef CONFIG_SHELL
+static int cmd_rtstats_show(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    thread_stats_print(sh);
+#ifndef CONFIG_APP_THREAD_STATS_SWITCHES
+    shell_print(sh, "(switch counting needs CONFIG_APP_THREAD_STATS_SWITCHES)");
+#endif
+    return 0;
+}
+
+static int cmd_rtstats_reset(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    thread_stats_reset();
+    shell_print(sh, "thread statistics reset");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_rtstats,
+    SHELL_CMD(show, NULL, "Print per-thread cycles, cpu %, switches and stack usage", cmd_rtstats_show),
+    SHELL_CMD(reset, NULL, "Restart the utilisation window", cmd_rtstats_reset),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(rtstats, &sub_rtstats, "Pipeline thread runtime statistics", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,45 @@
+/*
+ * Per-thread runtime statistics
+ *
+ * Tracks execution cycles, CPU utilisation, context switches and stack
+ * high-water mark of the registered threads (ADC, FILTRO and PWM).
+ * The table can be read with the "rtstats" shell command and printed
+ * periodically (CONFIG_APP_THREAD_STATS_PERIOD_MS).
+ */
+
+#ifndef THREAD_STATS_H
+#define THREAD_STATS_H
+
+#include <zephyr.h>
+
+struct shell;
+
+#ifdef CONFIG_APP_THREAD_STATS
+
+/* Adds a thread to the statistics table (also sets its name) */
+int thread_stats_register(k_tid_t tid, const char *name);
+
+/* Restarts the utilisation window of all registered threads */
+void thread_stats_reset(void);
+
+/* Prints the statistics table to 'sh', or with printk when it is NULL */
+void thread_stats_print(const struct shell *sh);
+
+#else
+
+static inline int thread_stats_register(k_tid_t tid, const char *name)
+{
+    ARG_UNUSED(tid);
+    ARG_UNUSED(name);
+    return 0;
+}
+
+static inline void thread_stats_reset(void) {}
+static inline void thread_stats_print(const struct shell *sh)
+{
+    ARG_UNUSED(sh);
+}
+
+#endif /* CONFIG_APP_THREAD_STATS */
+
+#endif /* THREAD_STATS_H */
@@ -0,0 +1,19 @@
+/*
+ * Pipeline markers for the CTF kernel trace
+ *
+ * Uses the same event framing as the kernel CTF events (ctf_top.h), so the
+ * markers share the time base and the output backend of the kernel trace.
+ */
+
+#include <zephyr.h>
+#include <ctf_top.h>
+
+#include "trace_markers.h"
+
+/* Event id of "app_marker" in tracing/app_events.tsdl */
+#define APP_CTF_EVENT_MARKER 0xF0
+
+void trace_mark(enum trace_marker marker, uint32_t arg)
+{
+    CTF_EVENT(CTF_LITERAL(uint8_t, APP_CTF_EVENT_MARKER), (uint8_t)marker, arg);
+}
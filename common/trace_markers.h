@@ -0,0 +1,37 @@
+/*
+ * Pipeline markers for the CTF kernel trace
+ *
+ * Thread switches and semaphore operations are traced by the kernel; these
+ * markers add the pipeline milestones and the FIFO hand-offs so that the
+ * whole ADC -> FILTRO -> PWM chain shows up in the same timeline.
+ */
+
+#ifndef TRACE_MARKERS_H
+#define TRACE_MARKERS_H
+
+#include <zephyr.h>
+
+/* Keep in sync with enum app_marker_id in tracing/app_events.tsdl */
+enum trace_marker {
+    TRACE_MARK_SAMPLE_ACQUIRED = 0,     /* arg: raw ADC value */
+    TRACE_MARK_FILTER_DONE = 1,         /* arg: filtered value (mV) */
+    TRACE_MARK_PWM_SET = 2,             /* arg: duty cycle (%) */
+    TRACE_MARK_QUEUE_PUT = 3,           /* arg: queue id */
+    TRACE_MARK_QUEUE_GET = 4,           /* arg: queue id */
+};
+
+/* Queue ids used with TRACE_MARK_QUEUE_PUT/GET */
+#define TRACE_QUEUE_VAL_1 1
+#define TRACE_QUEUE_MEDIA_FINAL 2
+
+#ifdef CONFIG_APP_TRACE_MARKERS
+void trace_mark(enum trace_marker marker, uint32_t arg);
+#else
+static inline void trace_mark(enum trace_marker marker, uint32_t arg)
+{
+    ARG_UNUSED(marker);
+    ARG_UNUSED(arg);
+}
+#endif
+
+#endif /* TRACE_MARKERS_H */
@@ -0,0 +1,147 @@
+/*
+ * Compressed waveform history of the pipeline
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <shell/shell.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wave_hist.h"
+#include "wavecomp.h"
+#include "pipeline_cfg.h"
+
+enum wave_stream {
+    WAVE_IN,
+    WAVE_OUT,
+    WAVE_STREAMS,
+};
+
+static const char *const stream_names[WAVE_STREAMS] = {
+    [WAVE_IN] = "in",
+    [WAVE_OUT] = "out",
+};
+
+static struct wave_chunk chunks[WAVE_STREAMS][CONFIG_APP_WAVE_HIST_CHUNKS];
+static struct wave_store stores[WAVE_STREAMS];
+static struct k_spinlock lock;
+
+void wave_hist_record(uint32_t t_release, uint16_t in_mv, uint16_t out_mv)
+{
+    /* Uptime of the release: the cycle stamp wraps within hours, its age does not */
+    uint32_t t_ms = (uint32_t)(k_uptime_get() - k_cyc_to_ms_floor32(k_cycle_get_32() - t_release));
+    struct pipeline_cfg cfg;
+    k_spinlock_key_t key;
+
+    /* pipeline_cfg_validate() keeps the period within 16 bits */
+    pipeline_cfg_get(&cfg);
+    key = k_spin_lock(&lock);
+
+    wave_store_put(&stores[WAVE_IN], t_ms, (uint16_t)cfg.adc_period_ms, in_mv);
+    wave_store_put(&stores[WAVE_OUT], t_ms, (uint16_t)cfg.adc_period_ms, out_mv);
+    k_spin_unlock(&lock, key);
+}
+
+static int wave_hist_init(const struct device *dev)
+{
+    ARG_UNUSED(dev);
+
+    for (int i = 0; i < WAVE_STREAMS; i++) {
+        wave_store_init(&stores[i], chunks[i], CONFIG_APP_WAVE_HIST_CHUNKS);
+    }
+    return 0;
+}
+
+SYS_INIT(wave_hist_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#ifdef CONFIG_SHELL
+static int cmd_whist_show(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    shell_print(sh, "%d chunks of %zu B per stream", CONFIG_APP_WAVE_HIST_CHUNKS,
+        sizeof(struct wave_chunk));
+    for (int i = 0; i < WAVE_STREAMS; i++) {
+        k_spinlock_key_t key = k_spin_lock(&lock);
+        const struct wave_chunk *first = wave_store_chunk(&stores[i], 0);
+        uint32_t t_first = first ? first->t0_ms : 0;
+        uint32_t held = 0, bytes = 0;
+        const struct wave_chunk *c;
+
+        for (uint32_t k = 0; (c = wave_store_chunk(&stores[i], k)) != NULL; k++) {
+            held += c->count;
+            bytes += sizeof(*c);
+        }
+        k_spin_unlock(&lock, key);
+
+        shell_print(sh, "  %-3s %u samples put, %u held from %u ms, %u.%02u B/sample",
+            stream_names[i], stores[i].n_samples, held, t_first, held ? bytes / held : 0,
+            held ? bytes * 100 / held % 100 : 0);
+    }
+    return 0;
+}
+
+static int cmd_whist_at(const struct shell *sh, size_t argc, char **argv)
+{
+    uint32_t t_ms = strtoul(argv[1], NULL, 0);
+
+    ARG_UNUSED(argc);
+
+    for (int i = 0; i < WAVE_STREAMS; i++) {
+        k_spinlock_key_t key = k_spin_lock(&lock);
+        uint16_t mv;
+        int err = wave_store_get(&stores[i], t_ms, &mv);
+
+        k_spin_unlock(&lock, key);
+        if (err) {
+            shell_print(sh, "  %-3s not held", stream_names[i]);
+        } else {
+            shell_print(sh, "  %-3s %u mV", stream_names[i], mv);
+        }
+    }
+    return 0;
+}
+
+/* One line per chunk: W <stream> <t0 ms> <period ms> <first> <count> <hex data> */
+static int cmd_whist_export(const struct shell *sh, size_t argc, char **argv)
+{
+    static struct wave_chunk c;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    for (int i = 0; i < WAVE_STREAMS; i++) {
+        for (uint32_t k = 0; ; k++) {
+            k_spinlock_key_t key = k_spin_lock(&lock);
+            const struct wave_chunk *src = wave_store_chunk(&stores[i], k);
+
+            if (src) {
+                c = *src;
+            }
+            k_spin_unlock(&lock, key);
+            if (!src) {
+                break;
+            }
+
+            shell_fprintf(sh, SHELL_NORMAL, "W %s %u %u %u %u ", stream_names[i], c.t0_ms,
+                c.period_ms, c.first, c.count);
+            for (int b = 0; b < c.len; b++) {
+                shell_fprintf(sh, SHELL_NORMAL, "%02x", c.data[b]);
+            }
+            shell_fprintf(sh, SHELL_NORMAL, "\n");
+        }
+    }
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_whist,
+    SHELL_CMD(show, NULL, "Time span and bytes per sample", cmd_whist_show),
+    SHELL_CMD_ARG(at, NULL, "Values at a time: <ms since boot>", cmd_whist_at, 2, 0),
+    SHELL_CMD(export, NULL, "Print the chunks for scripts/wave_decode.py", cmd_whist_export),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(whist, &sub_whist, "Compressed waveform history", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,32 @@
+/*
+ * Compressed waveform history of the pipeline
+ *
+ * Stores the FILTRO input and output streams with wavecomp.h, each in
+ * CONFIG_APP_WAVE_HIST_CHUNKS chunks, stamped with the ADC release time
+ * as uptime in ms. "whist show" reports the time span held and the bytes
+ * per sample, "whist at <ms>" the values at a given time, and "whist
+ * export" prints the chunks for scripts/wave_decode.py to turn into CSV.
+ */
+
+#ifndef WAVE_HIST_H
+#define WAVE_HIST_H
+
+#include <zephyr.h>
+
+#ifdef CONFIG_APP_WAVE_HIST
+
+/* Records one FILTRO input/output pair; t_release is a k_cycle_get_32() stamp */
+void wave_hist_record(uint32_t t_release, uint16_t in_mv, uint16_t out_mv);
+
+#else
+
+static inline void wave_hist_record(uint32_t t_release, uint16_t in_mv, uint16_t out_mv)
+{
+    ARG_UNUSED(t_release);
+    ARG_UNUSED(in_mv);
+    ARG_UNUSED(out_mv);
+}
+
+#endif /* CONFIG_APP_WAVE_HIST */
+
+#endif /* WAVE_HIST_H */
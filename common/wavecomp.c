@@ -0,0 +1,148 @@
+/*
+ * Compressed waveform store
+ */
+
+#include "wavecomp.h"
+
+static inline uint32_t zigzag(int32_t d)
+{
+    return ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t z)
+{
+    return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+
+static uint32_t held(const struct wave_store *s)
+{
+    return s->opened < s->n_chunks ? s->opened : s->n_chunks;
+}
+
+static struct wave_chunk *current(struct wave_store *s)
+{
+    return &s->chunks[(s->opened - 1) % s->n_chunks];
+}
+
+void wave_store_init(struct wave_store *s, struct wave_chunk *chunks, uint32_t n)
+{
+    s->chunks = chunks;
+    s->n_chunks = n;
+    s->opened = 0;
+    s->n_samples = 0;
+    s->prev = 0;
+}
+
+static void wave_store_open(struct wave_store *s, uint32_t t_ms, uint16_t period_ms,
+                            uint16_t value)
+{
+    struct wave_chunk *c = &s->chunks[s->opened % s->n_chunks];
+
+    c->t0_ms = t_ms;
+    c->period_ms = period_ms;
+    c->first = value;
+    c->count = 1;
+    c->len = 0;
+    s->opened++;
+}
+
+void wave_store_put(struct wave_store *s, uint32_t t_ms, uint16_t period_ms, uint16_t value)
+{
+    struct wave_chunk *c = s->opened ? current(s) : NULL;
+    int32_t late;
+    uint32_t z;
+
+    s->n_samples++;
+    if (c != NULL) {
+        /* Against the nominal time of the next sample of the chunk */
+        late = (int32_t)(t_ms - (c->t0_ms + (uint32_t)c->count * c->period_ms));
+    }
+    if (c == NULL || c->len > WAVE_CHUNK_BYTES - WAVE_VARINT_MAX ||
+        c->period_ms != period_ms || late >= period_ms || late <= -(int32_t)period_ms) {
+        wave_store_open(s, t_ms, period_ms, value);
+        s->prev = value;
+        return;
+    }
+
+    z = zigzag((int32_t)value - s->prev);
+    while (z >= 0x80) {
+        c->data[c->len++] = (uint8_t)(z | 0x80);
+        z >>= 7;
+    }
+    c->data[c->len++] = (uint8_t)z;
+    c->count++;
+    s->prev = value;
+}
+
+const struct wave_chunk *wave_store_chunk(const struct wave_store *s, uint32_t k)
+{
+    if (k >= held(s)) {
+        return NULL;
+    }
+    return &s->chunks[(s->opened - held(s) + k) % s->n_chunks];
+}
+
+/* Next zigzag difference of a chunk, read at *pos */
+static uint32_t varint_next(const struct wave_chunk *c, uint16_t *pos)
+{
+    uint32_t z = 0;
+    unsigned int shift = 0;
+    uint8_t b;
+
+    do {
+        b = c->data[(*pos)++];
+        z |= (uint32_t)(b & 0x7f) << shift;
+        shift += 7;
+    } while ((b & 0x80) && *pos < c->len);
+
+    return z;
+}
+
+size_t wave_chunk_decode(const struct wave_chunk *c, uint16_t *out, size_t max)
+{
+    uint16_t v = c->first;
+    size_t n = 0;
+    uint16_t pos = 0;
+
+    if (max == 0 || c->count == 0) {
+        return 0;
+    }
+    out[n++] = v;
+    while (n < max && n < c->count && pos < c->len) {
+        v = (uint16_t)(v + unzigzag(varint_next(c, &pos)));
+        out[n++] = v;
+    }
+    return n;
+}
+
+int wave_store_get(const struct wave_store *s, uint32_t t_ms, uint16_t *value)
+{
+    uint32_t lo = 0, hi = held(s);
+    const struct wave_chunk *c;
+    uint16_t v, pos = 0;
+    uint32_t i, n;
+
+    /* Last chunk starting at or before t_ms */
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        if ((int32_t)(wave_store_chunk(s, mid)->t0_ms - t_ms) <= 0) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    c = wave_store_chunk(s, lo);
+    if (c == NULL || (int32_t)(c->t0_ms - t_ms) > 0) {
+        return -1;
+    }
+
+    /* Decoded in place up to sample i, or the last one of the chunk */
+    i = c->period_ms ? (t_ms - c->t0_ms) / c->period_ms : 0;
+    v = c->first;
+    for (n = 1; n <= i && n < c->count && pos < c->len; n++) {
+        v = (uint16_t)(v + unzigzag(varint_next(c, &pos)));
+    }
+    *value = v;
+    return 0;
+}
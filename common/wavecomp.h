@@ -0,0 +1,69 @@
+/*
+ * Compressed waveform store
+ *
+ * Keeps a sample stream in a ring of fixed-size chunks. Each chunk holds
+ * its start time, sample period and first value in a header, then every
+ * following sample as the difference to the previous one, zigzag mapped
+ * (0, -1, 1, -2 ... -> 0, 1, 2, 3 ...) and written as a little-endian
+ * base-128 varint: one byte for steps of -64..63, three at most. Slow or
+ * filtered signals thus take about one byte per sample instead of two.
+ *
+ * A new chunk starts when the current one is full, the period changes or
+ * a sample arrives a period or more late; the oldest chunk is reused
+ * once the ring is full. Sample i of a chunk is at t0 + i * period, so
+ * wave_store_get() finds the value at any time still held by a binary
+ * search on the chunk start times plus a decode of one chunk.
+ * Plain C, so it also builds on the host (bench/, scripts/wave_decode.py
+ * decodes exported chunks).
+ */
+
+#ifndef WAVECOMP_H
+#define WAVECOMP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef WAVE_CHUNK_BYTES
+#ifdef CONFIG_APP_WAVE_HIST_CHUNK_BYTES
+#define WAVE_CHUNK_BYTES CONFIG_APP_WAVE_HIST_CHUNK_BYTES
+#else
+#define WAVE_CHUNK_BYTES 120
+#endif
+#endif
+
+/* Longest encoding of one 16-bit difference */
+#define WAVE_VARINT_MAX 3
+
+struct wave_chunk {
+    uint32_t t0_ms;             /* time of the first sample */
+    uint16_t period_ms;
+    uint16_t first;             /* first sample, stored as is */
+    uint16_t count;             /* samples, including the first */
+    uint16_t len;               /* bytes used in data */
+    uint8_t data[WAVE_CHUNK_BYTES];
+};
+
+struct wave_store {
+    struct wave_chunk *chunks;
+    uint32_t n_chunks;
+    uint32_t opened;            /* chunks started, also the ring write index */
+    uint32_t n_samples;
+    uint16_t prev;              /* last sample put */
+};
+
+/* Uses 'chunks' (n of them) as an empty ring */
+void wave_store_init(struct wave_store *s, struct wave_chunk *chunks, uint32_t n);
+
+/* Appends one sample taken at t_ms with the nominal period period_ms */
+void wave_store_put(struct wave_store *s, uint32_t t_ms, uint16_t period_ms, uint16_t value);
+
+/* Chunk k, 0 being the oldest still held; NULL past the newest */
+const struct wave_chunk *wave_store_chunk(const struct wave_store *s, uint32_t k);
+
+/* Value of the last sample taken at or before t_ms; -1 if not held */
+int wave_store_get(const struct wave_store *s, uint32_t t_ms, uint16_t *value);
+
+/* Decodes up to max samples of a chunk; returns how many */
+size_t wave_chunk_decode(const struct wave_chunk *c, uint16_t *out, size_t max);
+
+#endif /* WAVECOMP_H */
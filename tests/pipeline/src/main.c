@@ -0,0 +1,184 @@
+/*
+ * Pipeline test on native_posix
+ *
+ * Runs the Fifo application with the ADC emulator fed by adc_waveform.c
+ * and checks the duty cycles recorded by the PWM stub: a constant input
+ * settles on its duty, a step moves monotonically to the new level within
+ * one filter window, and a square wave reaches both of its levels.
+ */
+
+#include <ztest.h>
+#include <device.h>
+#include <devicetree.h>
+#include <limits.h>
+
+#include "adc_waveform.h"
+#include "pwm_stub.h"
+#include "convert.h"
+
+#define PERIOD_MS CONFIG_APP_ADC_PERIOD_MS
+#define WINDOW CONFIG_APP_FILTER_WINDOW
+
+/* Samples that can be queued in the two hand-offs when the input changes */
+#define IN_FLIGHT (2 * CONFIG_APP_HANDOFF_DEPTH + 2)
+
+/* History ring of the stub (history-size in the native_posix overlay) */
+#define HISTORY 64
+
+/* Duty steps the ADC emulator rounding may add */
+#define DUTY_TOL 1
+
+/* Application entry point, renamed by CMakeLists.txt */
+void pipeline_main(void);
+
+static const struct device *pwm = DEVICE_DT_GET(DT_NODELABEL(pwm0));
+static struct pwm_stub_event ev[HISTORY];
+
+static unsigned int ev_duty(const struct pwm_stub_event *e)
+{
+    return e->pulse_us * 100 / e->period_us;
+}
+
+static void set_wave(enum adc_waveform_type type, uint32_t offset_mv,
+                     uint32_t amplitude_mv, uint32_t period_ms)
+{
+    struct adc_waveform w = {
+        .type = type,
+        .offset_mv = offset_mv,
+        .amplitude_mv = amplitude_mv,
+        .period_ms = period_ms,
+    };
+
+    zassert_ok(adc_waveform_set(&w), "waveform rejected");
+}
+
+/* Waits for 'n' more PWM updates; returns the update count before them */
+static uint32_t wait_updates(uint32_t n)
+{
+    uint32_t start = pwm_stub_update_count(pwm);
+
+    for (uint32_t i = 0; i < 4 * n && pwm_stub_update_count(pwm) - start < n; i++) {
+        k_msleep(PERIOD_MS);
+    }
+    zassert_true(pwm_stub_update_count(pwm) - start >= n, "pipeline stalled");
+
+    return start;
+}
+
+/* Copies the updates made since 'mark' (at most HISTORY) into ev[] */
+static size_t updates_since(uint32_t mark)
+{
+    size_t n = MIN(pwm_stub_update_count(pwm) - mark, HISTORY);
+
+    return pwm_stub_history_get(pwm, ev, n);
+}
+
+static void test_constant_input(void)
+{
+    unsigned int duty = convert_mv_to_duty(1500);
+    size_t n;
+
+    set_wave(ADC_WAVEFORM_CONST, 1500, 0, 1);
+    wait_updates(WINDOW + IN_FLIGHT);
+
+    n = pwm_stub_history_get(pwm, ev, WINDOW);
+    zassert_equal(n, WINDOW, "history too short");
+    for (size_t i = 0; i < n; i++) {
+        zassert_within(ev_duty(&ev[i]), duty, DUTY_TOL,
+            "update %u: duty %u, expected %u", (unsigned int)i, ev_duty(&ev[i]), duty);
+    }
+}
+
+static void test_step_response(void)
+{
+    unsigned int lo = convert_mv_to_duty(1000);
+    unsigned int hi = convert_mv_to_duty(2000);
+    uint32_t mark;
+    size_t n, settled;
+
+    set_wave(ADC_WAVEFORM_CONST, 1000, 0, 1);
+    wait_updates(WINDOW + IN_FLIGHT);
+
+    mark = pwm_stub_update_count(pwm);
+    set_wave(ADC_WAVEFORM_CONST, 2000, 0, 1);
+    wait_updates(2 * WINDOW + IN_FLIGHT);
+    n = updates_since(mark);
+
+    /* The moving average never overshoots and never moves back */
+    settled = n;
+    for (size_t i = 0; i < n; i++) {
+        unsigned int d = ev_duty(&ev[i]);
+
+        zassert_true(d + DUTY_TOL >= lo && d <= hi + DUTY_TOL,
+            "update %u: duty %u outside %u..%u", (unsigned int)i, d, lo, hi);
+        if (i > 0) {
+            zassert_true(d >= ev_duty(&ev[i - 1]), "update %u: duty went back", (unsigned int)i);
+        }
+        if (settled == n && d + DUTY_TOL >= hi) {
+            settled = i;
+        }
+    }
+
+    /* One window of new samples replaces the whole history */
+    zassert_true(settled <= WINDOW + IN_FLIGHT, "settled after %u updates", (unsigned int)settled);
+    for (size_t i = n - WINDOW; i < n; i++) {
+        zassert_within(ev_duty(&ev[i]), hi, DUTY_TOL, "update %u not settled", (unsigned int)i);
+    }
+}
+
+static void test_square_wave(void)
+{
+    /* Each half period is longer than a window, so both levels are reached */
+    uint32_t period_ms = 4 * WINDOW * PERIOD_MS;
+    uint32_t samples = period_ms / PERIOD_MS;
+    unsigned int lo = convert_mv_to_duty(500);
+    unsigned int hi = convert_mv_to_duty(2500);
+    unsigned int d_min = UINT_MAX, d_max = 0;
+    size_t n;
+
+    set_wave(ADC_WAVEFORM_SQUARE, 1500, 1000, period_ms);
+    wait_updates(samples / 2 + IN_FLIGHT);
+    wait_updates(samples);
+
+    n = pwm_stub_history_get(pwm, ev, samples);
+    for (size_t i = 0; i < n; i++) {
+        unsigned int d = ev_duty(&ev[i]);
+
+        zassert_true(d + DUTY_TOL >= lo && d <= hi + DUTY_TOL,
+            "update %u: duty %u outside %u..%u", (unsigned int)i, d, lo, hi);
+        d_min = MIN(d_min, d);
+        d_max = MAX(d_max, d);
+    }
+    zassert_within(d_min, lo, DUTY_TOL, "low level %u, expected %u", d_min, lo);
+    zassert_within(d_max, hi, DUTY_TOL, "high level %u, expected %u", d_max, hi);
+}
+
+static void test_waveform_limits(void)
+{
+    struct adc_waveform w = {
+        .type = ADC_WAVEFORM_SINE,
+        .offset_mv = 1500,
+        .amplitude_mv = 500,
+        .period_ms = 0,
+    };
+
+    zassert_equal(adc_waveform_set(&w), -EINVAL, "zero period accepted");
+    w.period_ms = 1000;
+    w.amplitude_mv = 1600;
+    zassert_equal(adc_waveform_set(&w), -EINVAL, "swing below 0 V accepted");
+    w.offset_mv = 3001;
+    w.amplitude_mv = 0;
+    zassert_equal(adc_waveform_set(&w), -EINVAL, "offset above full scale accepted");
+}
+
+void test_main(void)
+{
+    pipeline_main();
+
+    ztest_test_suite(pipeline_native,
+        ztest_unit_test(test_constant_input),
+        ztest_unit_test(test_step_response),
+        ztest_unit_test(test_square_wave),
+        ztest_unit_test(test_waveform_limits));
+    ztest_run_test_suite(pipeline_native);
+}